@@ -0,0 +1,489 @@
+#include <algorithm>
+#include <chrono>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "stack.h"
+#include "stack_logs.h"
+#include "stack_vm.h"
+#include "stack_hash.h"
+#include "stack_fixed.h"
+#include "stack_tiered.h"
+#include "stack_simd.h"
+#include "stack_batch.h"
+
+typedef std::chrono::steady_clock BenchClock;
+
+static double benchSeconds(BenchClock::time_point start)
+{
+    return std::chrono::duration<double>(BenchClock::now() - start).count();
+}
+
+/**
+ * @brief opens counter of instructions retired by this thread in user mode
+ *
+ * @return file descriptor or -1 if there is no hardware counter
+ */
+static int benchInstructionsOpen()
+{
+    perf_event_attr attr = {};
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static uint64_t benchInstructionsRead(int fd)
+{
+    uint64_t count = 0;
+    if (read(fd, &count, sizeof(count)) != (ssize_t) sizeof(count))
+        return 0;
+    return count;
+}
+
+static const char *const VM_COUNTDOWN =
+    "    push 200000\n"
+    "loop:\n"
+    "    push 1\n"
+    "    sub\n"
+    "    dup\n"
+    "    jnz loop\n"
+    "    pop\n"
+    "    halt\n";
+
+static const char *const VM_FIBONACCI =
+    "    push 0\n"
+    "    push 1\n"
+    "    push 100000\n"
+    "loop:\n"
+    "    rot\n"
+    "    rot\n"
+    "    swap\n"
+    "    over\n"
+    "    add\n"
+    "    rot\n"
+    "    push 1\n"
+    "    sub\n"
+    "    dup\n"
+    "    jnz loop\n"
+    "    pop\n"
+    "    halt\n";
+
+static void benchVm(const char *name, const char *text)
+{
+    VmProgram program = {};
+    if (vmAssemble(text, &program))
+    {
+        printf("vm %-12s can't assemble program\n", name);
+        return;
+    }
+
+    size_t (*executors[])(const VmProgram *, Stack *, size_t *) = {
+        vmExecuteNaive, vmExecute
+    };
+    const char *executorNames[] = {"naive", "cached"};
+
+    for (size_t i = 0; i < 2; i++)
+    {
+        Stack stack = {};
+        size_t error = STACK_NO_ERRORS;
+        size_t executed = 0;
+        stackCtor(&stack, 0, &error)
+
+        BenchClock::time_point start = BenchClock::now();
+        error |= executors[i](&program, &stack, &executed);
+        double seconds = benchSeconds(start);
+
+        printf("vm %-12s %-8s %10zu instructions %8.3f s "
+               "%12.0f instructions/s%s\n",
+               name,
+               executorNames[i],
+               executed,
+               seconds,
+               (double) executed / seconds,
+               error ? " (error)" : "");
+        stackDtor(&stack);
+    }
+
+    vmProgramDtor(&program);
+}
+
+#if (HashProtection)
+static void benchHash(size_t numOfElements)
+{
+    Elem_t *values = (Elem_t *) calloc(numOfElements, sizeof(Elem_t));
+    if (values == nullptr)
+        return;
+    for (size_t i = 0; i < numOfElements; i++)
+        values[i] = (Elem_t) i;
+
+    Stack stack = {};
+    size_t error = STACK_NO_ERRORS;
+    stackCtor(&stack, 0, &error)
+    error |= stackPushMany(&stack, values, numOfElements);
+    free(values);
+
+    StackHashConfig defaultConfig = stackHashGetConfig();
+    StackHashConfig config = defaultConfig;
+    size_t size = (size_t) stack.capacity * sizeof(Elem_t);
+
+    BenchClock::time_point start = BenchClock::now();
+    hashData(stack.data, size);
+    double serial = benchSeconds(start);
+    printf("hash %6zu MiB serial       %8.3f s\n", size >> 20, serial);
+
+    for (unsigned threads = 1; threads <= 32; threads *= 2)
+    {
+        config.threads = threads;
+        stackHashConfigure(config);
+
+        start = BenchClock::now();
+        hashDataChunked(stack.data, size, nullptr);
+        double seconds = benchSeconds(start);
+        printf("hash %6zu MiB %2u threads   %8.3f s %6.2fx%s\n",
+               size >> 20,
+               threads,
+               seconds,
+               serial / seconds,
+               error ? " (error)" : "");
+    }
+
+    stackHashConfigure(defaultConfig);
+    stackDtor(&stack);
+}
+#endif
+
+static void benchFixed(size_t numOfElements, size_t rounds)
+{
+    Stack stack = {};
+    size_t error = STACK_NO_ERRORS;
+    stackCtor(&stack, 0, &error)
+
+    BenchClock::time_point start = BenchClock::now();
+    for (size_t round = 0; round < rounds; round++)
+    {
+        Elem_t value = 0;
+        for (size_t i = 0; i < numOfElements; i++)
+            error |= stackPush(&stack, (Elem_t) i);
+        for (size_t i = 0; i < numOfElements; i++)
+            error |= stackPop(&stack, &value);
+    }
+    double heap = benchSeconds(start);
+    stackDtor(&stack);
+
+    size_t length = fixedStackBufferLength(numOfElements);
+    Elem_t *buffer = (Elem_t *) calloc(length, sizeof(Elem_t));
+    if (buffer == nullptr)
+        return;
+
+    FixedStack fixed = {};
+    fixedStackCtor(&fixed, buffer, length, &error)
+
+    start = BenchClock::now();
+    for (size_t round = 0; round < rounds; round++)
+    {
+        Elem_t value = 0;
+        for (size_t i = 0; i < numOfElements; i++)
+            error |= fixedStackPush(&fixed, (Elem_t) i);
+        for (size_t i = 0; i < numOfElements; i++)
+            error |= fixedStackPop(&fixed, &value);
+    }
+    double seconds = benchSeconds(start);
+    fixedStackDtor(&fixed);
+    free(buffer);
+
+    double ops = 2.0 * (double) (numOfElements * rounds);
+    printf("fixed %6zu elements heap  %8.3f s %12.0f ops/s\n",
+           numOfElements, heap, ops / heap);
+    printf("fixed %6zu elements fixed %8.3f s %12.0f ops/s %6.2fx%s\n",
+           numOfElements,
+           seconds,
+           ops / seconds,
+           heap / seconds,
+           error ? " (error)" : "");
+}
+
+const size_t BENCH_PUSH_POP_BURST = 16;
+
+__attribute__((noinline))
+static size_t benchPushPopInline(Stack *stack, size_t rounds)
+{
+    size_t error = STACK_NO_ERRORS;
+    Elem_t value = 0;
+    for (size_t round = 0; round < rounds; round++)
+    {
+        for (size_t i = 0; i < BENCH_PUSH_POP_BURST; i++)
+            error |= stackPush(stack, (Elem_t) i);
+        for (size_t i = 0; i < BENCH_PUSH_POP_BURST; i++)
+            error |= stackPop(stack, &value);
+    }
+    return error;
+}
+
+__attribute__((noinline))
+static size_t benchPushPopSlow(Stack *stack, size_t rounds)
+{
+    size_t error = STACK_NO_ERRORS;
+    Elem_t value = 0;
+    for (size_t round = 0; round < rounds; round++)
+    {
+        for (size_t i = 0; i < BENCH_PUSH_POP_BURST; i++)
+            error |= stackPushSlow(stack, (Elem_t) i);
+        for (size_t i = 0; i < BENCH_PUSH_POP_BURST; i++)
+            error |= stackPopSlow(stack, &value);
+    }
+    return error;
+}
+
+/**
+ * @brief compares inline fast path of push and pop with out-of-line one
+ *
+ * Bursts of pushes and pops go on top of numOfElements elements, so
+ * after first round stack is never resized.
+ */
+static void benchPushPop(size_t numOfElements, size_t rounds)
+{
+    size_t (*loops[])(Stack *, size_t) = {
+        benchPushPopSlow, benchPushPopInline
+    };
+    const char *loopNames[] = {"slow", "inline"};
+    int fd = benchInstructionsOpen();
+
+    Elem_t *values = (Elem_t *) calloc(numOfElements, sizeof(Elem_t));
+    if (values == nullptr)
+        return;
+
+    for (size_t i = 0; i < 2; i++)
+    {
+        Stack stack = {};
+        size_t error = STACK_NO_ERRORS;
+        stackCtor(&stack, 0, &error)
+        error |= stackPushMany(&stack, values, numOfElements);
+        error |= loops[i](&stack, 1);
+
+        if (fd != -1)
+        {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+        BenchClock::time_point start = BenchClock::now();
+        error |= loops[i](&stack, rounds);
+        double seconds = benchSeconds(start);
+        if (fd != -1)
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+
+        double ops = 2.0 * (double) (BENCH_PUSH_POP_BURST * rounds);
+        char instructions[32] = "n/a";
+        if (fd != -1)
+            snprintf(instructions, sizeof(instructions), "%.1f",
+                     (double) benchInstructionsRead(fd) / ops);
+
+        printf("pushpop %-6s %6zu elements %8.3f s %8.2f ns/op "
+               "%8s instructions/op (fast path %d)%s\n",
+               loopNames[i],
+               numOfElements,
+               seconds,
+               seconds * 1e9 / ops,
+               instructions,
+               InlineFastPath,
+               error ? " (error)" : "");
+        stackDtor(&stack);
+    }
+
+    free(values);
+    if (fd != -1)
+        close(fd);
+}
+
+#if (PoisonProtection)
+/**
+ * @brief compares poison scan and fill kernels, scan goes through whole
+ * buffer because there are no poisoned elements
+ */
+static void benchPoison(size_t numOfElements, size_t totalElements)
+{
+    Elem_t *data = (Elem_t *) calloc(numOfElements, sizeof(Elem_t));
+    if (data == nullptr)
+        return;
+
+    size_t rounds = totalElements / numOfElements;
+    double elements = (double) (rounds * numOfElements);
+    StackSimdLevel best = stackSimdGetLevel();
+    double scalarScan = 0;
+    double scalarFill = 0;
+
+    for (int level = STACK_SIMD_SCALAR; level <= best; level++)
+    {
+        stackSimdSetLevel((StackSimdLevel) level);
+
+        std::fill(data, data + numOfElements, 1);
+        size_t found = 0;
+        BenchClock::time_point start = BenchClock::now();
+        for (size_t round = 0; round < rounds; round++)
+            found += stackFindPoison(data, numOfElements);
+        double scan = benchSeconds(start);
+
+        start = BenchClock::now();
+        for (size_t round = 0; round < rounds; round++)
+            stackFillPoison(data, numOfElements);
+        double fill = benchSeconds(start);
+
+        if (level == STACK_SIMD_SCALAR)
+        {
+            scalarScan = scan;
+            scalarFill = fill;
+        }
+
+        printf("poison %-6s %6zu elements scan %6.3f ns/elem %6.2fx "
+               "fill %6.3f ns/elem %6.2fx%s\n",
+               stackSimdName((StackSimdLevel) level),
+               numOfElements,
+               scan * 1e9 / elements,
+               scalarScan / scan,
+               fill * 1e9 / elements,
+               scalarFill / fill,
+               found != rounds * numOfElements ? " (error)" : "");
+    }
+
+    stackSimdSetLevel(best);
+    free(data);
+}
+#endif
+
+/**
+ * @brief compares pushing and popping on many separate stacks with batch
+ * operations on same number of stacks
+ */
+static void benchBatch(size_t numOfStacks, size_t rounds)
+{
+    Stack *stacks = (Stack *) calloc(numOfStacks, sizeof(Stack));
+    Elem_t *values = (Elem_t *) calloc(numOfStacks, sizeof(Elem_t));
+    if (stacks == nullptr or values == nullptr)
+    {
+        free(stacks);
+        free(values);
+        return;
+    }
+
+    size_t error = STACK_NO_ERRORS;
+    for (size_t i = 0; i < numOfStacks; i++)
+    {
+        stacks[i] = {};
+        stackCtor(&stacks[i], 0, &error)
+    }
+
+    BenchClock::time_point start = BenchClock::now();
+    for (size_t round = 0; round < rounds; round++)
+    {
+        for (size_t i = 0; i < numOfStacks; i++)
+            error |= stackPush(&stacks[i], (Elem_t) i);
+        for (size_t i = 0; i < numOfStacks; i++)
+            error |= stackPop(&stacks[i], &values[i]);
+    }
+    double separate = benchSeconds(start);
+
+    for (size_t i = 0; i < numOfStacks; i++)
+        error |= stackDtor(&stacks[i]);
+
+    double ops = 2.0 * (double) (numOfStacks * rounds);
+    printf("batch %6zu stacks separate %8.3f s %8.2f ns/op\n",
+           numOfStacks, separate, separate * 1e9 / ops);
+
+    StackSimdLevel best = stackSimdGetLevel();
+    for (int level = STACK_SIMD_SCALAR; level <= best; level++)
+    {
+        stackSimdSetLevel((StackSimdLevel) level);
+
+        StackBatch batch = {};
+        stackBatchCtor(&batch, numOfStacks, BENCH_PUSH_POP_BURST, &error)
+
+        start = BenchClock::now();
+        for (size_t round = 0; round < rounds; round++)
+        {
+            error |= stackBatchPush(&batch, values, nullptr, nullptr);
+            error |= stackBatchPop(&batch, values, nullptr, nullptr);
+        }
+        double seconds = benchSeconds(start);
+        error |= stackBatchDtor(&batch);
+
+        printf("batch %6zu stacks %-8s %8.3f s %8.2f ns/op %6.2fx%s\n",
+               numOfStacks,
+               stackSimdName((StackSimdLevel) level),
+               seconds,
+               seconds * 1e9 / ops,
+               separate / seconds,
+               error ? " (error)" : "");
+    }
+    stackSimdSetLevel(best);
+
+    free(stacks);
+    free(values);
+}
+
+static void benchTiered(TieredStorage storage, size_t numOfElements)
+{
+    TieredStackConfig config = {};
+    config.segmentSize = 1024;
+    config.hotSegments = 2;
+    config.storage = storage;
+    const char *name = storage == TIERED_STORAGE_FILE ? "file" : "compressed";
+
+    TieredStack stack = {};
+    size_t error = STACK_NO_ERRORS;
+    tieredStackCtor(&stack, config, &error)
+
+    for (size_t i = 0; i < numOfElements; i++)
+        error |= tieredStackPush(&stack, (Elem_t) (i % 1000));
+
+    TieredStackStats stats = stack.stats;
+    size_t resident = (size_t) stack.hot.capacity * sizeof(Elem_t);
+    if (storage == TIERED_STORAGE_COMPRESSED)
+        resident += stats.storedBytes;
+
+    BenchClock::time_point start = BenchClock::now();
+    for (size_t i = 0; i < numOfElements; i++)
+    {
+        Elem_t value = 0;
+        error |= tieredStackPop(&stack, &value);
+    }
+    double seconds = benchSeconds(start);
+
+    printf("tiered %-10s %8zu elements resident %8zu bytes of %8zu "
+           "ratio %5.2f pops %8.3f s load %8.0f ns/segment%s\n",
+           name,
+           numOfElements,
+           resident,
+           numOfElements * sizeof(Elem_t),
+           (double) stats.rawBytes / (double) stats.storedBytes,
+           seconds,
+           (double) stack.stats.loadNanoseconds
+               / (double) stack.stats.loaded,
+           error ? " (error)" : "");
+    tieredStackDtor(&stack);
+}
+
+int main()
+{
+    benchVm("countdown", VM_COUNTDOWN);
+    benchVm("fibonacci", VM_FIBONACCI);
+#if (HashProtection)
+    benchHash(16 << 20);
+#endif
+    benchFixed(64, 2000);
+    benchFixed(1024, 20);
+    benchPushPop(64, 2000);
+#if (PoisonProtection)
+    for (size_t numOfElements = 16; numOfElements <= 1 << 16;
+         numOfElements *= 16)
+        benchPoison(numOfElements, 1 << 26);
+#endif
+    benchBatch(4096, 20);
+    benchTiered(TIERED_STORAGE_FILE, 1 << 15);
+    benchTiered(TIERED_STORAGE_COMPRESSED, 1 << 15);
+    return 0;
+}
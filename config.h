@@ -1,3 +1,34 @@
+#ifndef AsanProtection
+#define AsanProtection 0
+#endif
+
+#ifndef HashProtection
 #define HashProtection   1
+#endif
+#ifndef CanaryProtection
 #define CanaryProtection 1
-#define PoisonProtection 1
\ No newline at end of file
+#endif
+#ifndef PoisonProtection
+#if (AsanProtection)
+#define PoisonProtection 0
+#else
+#define PoisonProtection 1
+#endif
+#endif
+#ifndef FrameCanaryProtection
+#define FrameCanaryProtection 1
+#endif
+
+#ifndef WatchdogProtection
+#define WatchdogProtection 0
+#endif
+
+#ifndef TraceRecording
+#define TraceRecording 0
+#endif
+
+#ifndef InlineFastPath
+#define InlineFastPath (!HashProtection && !CanaryProtection                \
+    && !PoisonProtection && !WatchdogProtection && !AsanProtection          \
+    && !TraceRecording)
+#endif
\ No newline at end of file
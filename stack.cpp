@@ -1,6 +1,41 @@
 #include "stack.h"
 #include "stack_verification.h"
 #include "stack_logs.h"
+#include "stack_watchdog.h"
+#include "stack_hash.h"
+#include "stack_trace.h"
+#include "stack_budget.h"
+#include "stack_simd.h"
+
+#include <atomic>
+
+#if (AsanProtection)
+#include <sanitizer/asan_interface.h>
+#endif
+
+static StackInfo STACK_CALLSITES[STACK_MAX_CALLSITES] = {};
+static std::atomic<StackInfoId> STACK_CALLSITES_COUNT(1);
+
+StackInfoId stackInfoRegister(StackInfo info)
+{
+    StackInfoId id = STACK_CALLSITES_COUNT.fetch_add(1);
+    if (id >= STACK_MAX_CALLSITES)
+    {
+        STACK_CALLSITES_COUNT.store(STACK_MAX_CALLSITES);
+        return STACK_UNKNOWN_INFO_ID;
+    }
+
+    STACK_CALLSITES[id] = info;
+    return id;
+}
+
+const StackInfo *stackInfoGet(StackInfoId id)
+{
+    if (id >= STACK_MAX_CALLSITES)
+        return &STACK_CALLSITES[STACK_UNKNOWN_INFO_ID];
+
+    return &STACK_CALLSITES[id];
+}
 
 size_t stackCtor__(Stack *stack, size_t numOfElements)
 {
@@ -8,27 +43,28 @@ size_t stackCtor__(Stack *stack, size_t numOfElements)
 
     size_t error = STACK_NO_ERRORS;
 
-    size_t dataSize = numOfElements * sizeof(Elem_t);
+    if (numOfElements > STACK_MAX_CAPACITY)
+        return CANT_ALLOCATE_MEMORY_FOR_STACK;
 
-#if (CanaryProtection)
-    char *canary_data_canary = (char *) calloc(
-        dataSize + 2 * sizeof(Canary), sizeof(char));
-    stack->data = (Elem_t *) (canary_data_canary + sizeof(Canary));
+    stack->budgetGroup = STACK_BUDGET_DEFAULT_GROUP;
+    error = stackBudgetAcquire(stack,
+                               stack->budgetGroup,
+                               numOfElements * sizeof(Elem_t));
+    if (error)
+        return error;
 
-    if (canary_data_canary == nullptr)
+    stack->data = (Elem_t *) stackReallocData(
+        nullptr, numOfElements * sizeof(Elem_t));
+    if (stack->data == nullptr)
+    {
+        stackBudgetRelease(stack->budgetGroup,
+                           numOfElements * sizeof(Elem_t));
         return CANT_ALLOCATE_MEMORY_FOR_STACK;
+    }
 
-    *(Canary *) canary_data_canary = CANARY_START;
-    *(Canary *) (canary_data_canary + sizeof(Canary) + dataSize) =
-        CANARY_END;
-
+#if (CanaryProtection)
     stack->canary_start = CANARY_START;
     stack->canary_end = CANARY_END;
-
-#else
-    stack->data = (Elem_t *) calloc(dataSize, 1);
-    if (stack->data == nullptr)
-        return CANT_ALLOCATE_MEMORY_FOR_STACK;
 #endif
 
 #if (PoisonProtection)
@@ -36,12 +72,21 @@ size_t stackCtor__(Stack *stack, size_t numOfElements)
 #endif
 
     stack->size = 0;
-    stack->capacity = numOfElements;
+    stack->capacity = (StackSize_t) numOfElements;
     stack->alive = true;
+#if (AsanProtection)
+    stackAnnotateData(stack, 0);
+#endif
 
 # if (HashProtection)
-    stack->dataHash = stackHashBuffer(stack);
-    stack->hash = stackHash(stack);
+    stackUpdateHash(stack);
+#endif
+
+#if (WatchdogProtection)
+    stackWatchdogRegister(stack);
+#endif
+#if (TraceRecording)
+    stackTraceRecord(stack, TRACE_CTOR, (Elem_t) numOfElements);
 #endif
 
     ASSERT_OK(stack, &error)
@@ -49,7 +94,7 @@ size_t stackCtor__(Stack *stack, size_t numOfElements)
     return error;
 }
 
-size_t stackPush(Stack *stack, Elem_t value)
+size_t stackPushSlow(Stack *stack, Elem_t value)
 {
     assert(stack != nullptr);
 
@@ -59,23 +104,30 @@ size_t stackPush(Stack *stack, Elem_t value)
     if (error)
         return error;
 
-    if (stack->size == stack->capacity)
+    STACK_WRITE_GUARD(stack)
+    if (STACK_UNLIKELY(stack->size == stack->capacity))
         error = stackResize(stack);
 
     if (error)
         return error;
 
+#if (AsanProtection)
+    __asan_unpoison_memory_region(stack->data + stack->size, sizeof(Elem_t));
+#endif
     stack->data[stack->size++] = value;
+    stack->generation++;
+#if (TraceRecording)
+    stackTraceRecord(stack, TRACE_PUSH, value);
+#endif
 #if (HashProtection)
-    stack->dataHash = stackHashBuffer(stack);
-    stack->hash = stackHash(stack);
+    stackUpdateHash(stack);
 #endif
     ASSERT_OK(stack, &error)
 
     return error;
 }
 
-size_t stackPop(Stack *stack, Elem_t *value)
+size_t stackPopSlow(Stack *stack, Elem_t *value)
 {
     assert(stack != nullptr);
     assert(value != nullptr);
@@ -90,19 +142,26 @@ size_t stackPop(Stack *stack, Elem_t *value)
         *value = 0;
         return STACK_IS_EMPTY;
     }
+
+    STACK_WRITE_GUARD(stack)
     stack->size--;
+    stack->generation++;
     *value = stack->data[stack->size];
+#if (AsanProtection)
+    __asan_poison_memory_region(stack->data + stack->size, sizeof(Elem_t));
+#endif
+#if (TraceRecording)
+    stackTraceRecord(stack, TRACE_POP, *value);
+#endif
 
 #if (HashProtection)
-    stack->dataHash = stackHashBuffer(stack);
-    stack->hash = stackHash(stack);
+    stackUpdateHash(stack);
 #endif
-    if (stack->size * 4 <= stack->capacity)
+    if ((size_t) stack->size * 4 <= stack->capacity)
         error = stackResize(stack);
 
 #if (HashProtection)
-    stack->dataHash = stackHashBuffer(stack);
-    stack->hash = stackHash(stack);
+    stackUpdateHash(stack);
 #endif
     ASSERT_OK(stack, &error)
 
@@ -116,12 +175,15 @@ size_t stackShrinkToFit(Stack *stack)
     size_t error = STACK_NO_ERRORS;
     if (stack->size == 0)
     {
-#if (CanaryProtection)
-        free((char *) stack->data - sizeof(Canary));
-#else
-        free(stack->data);
+        STACK_WRITE_GUARD(stack)
+#if (WatchdogProtection)
+        stackWatchdogWait(stack);
 #endif
+        stackFreeData(stack->data);
+        stackBudgetRelease(stack->budgetGroup,
+                           (size_t) stack->capacity * sizeof(Elem_t));
         stack->data = nullptr;
+        stack->generation++;
         ASSERT_OK(stack, &error)
         return error;
     }
@@ -133,54 +195,132 @@ size_t stackShrinkToFit(Stack *stack)
 }
 
 #if (PoisonProtection)
+void stackPoisonRange(Elem_t *data, size_t count)
+{
+    assert(data != nullptr);
+
+    stackFillPoison(data, count);
+}
+
 void stackPoisonData(Stack *stack)
 {
-    for (size_t i = stack->size; i < stack->capacity; i++)
-    {
-        stack->data[i] = POISON_VALUE;
-    }
+    stackPoisonRange(stack->data + stack->size,
+                     stack->capacity - stack->size);
 }
 #endif
 
-size_t stackResizeMemory(Stack *stack, size_t newStackCapacity)
+#if (AsanProtection)
+void stackAnnotateData(Stack *stack, size_t writable)
 {
-    size_t error = 0;
-    size_t newCapacity = sizeof(Elem_t) * newStackCapacity;
+    assert(stack != nullptr);
+    assert(writable <= stack->capacity);
+
+    if (stack->data == nullptr)
+        return;
+
+    __asan_unpoison_memory_region(stack->data, writable * sizeof(Elem_t));
+    __asan_poison_memory_region(stack->data + writable,
+                                (stack->capacity - writable)
+                                    * sizeof(Elem_t));
+}
+#endif
+
+void *stackReallocData(void *data, size_t dataSize)
+{
+#if (CanaryProtection)
+    char *canary_data_canary = nullptr;
+    if (data == nullptr)
+        canary_data_canary = (char *) calloc(
+            dataSize + 2 * sizeof(Canary), sizeof(char));
+    else
+        canary_data_canary = (char *) realloc(
+            (char *) data - sizeof(Canary), dataSize + 2 * sizeof(Canary));
+
+    if (canary_data_canary == nullptr)
+        return nullptr;
+
+    *(Canary *) canary_data_canary = CANARY_START;
+    *(Canary *) (canary_data_canary + sizeof(Canary) + dataSize) =
+        CANARY_END;
+
+    return canary_data_canary + sizeof(Canary);
+#else
+    if (data == nullptr)
+        return calloc(dataSize, 1);
+
+    return realloc(data, dataSize);
+#endif
+}
+
+void stackFreeData(void *data)
+{
+    if (data == nullptr)
+        return;
 
 #if (CanaryProtection)
-    char *newData =
-        (char *) realloc((char *) stack->data - sizeof(Canary),
-                         newCapacity + 2 * sizeof(Canary));
+    free((char *) data - sizeof(Canary));
 #else
-    Elem_t *newData = (Elem_t *) realloc(stack->data, newCapacity);
+    free(data);
 #endif
+}
 
-    if (newData == nullptr)
+size_t stackResizeMemory(Stack *stack, size_t newStackCapacity)
+{
+    size_t error = 0;
+    if (newStackCapacity > STACK_MAX_CAPACITY)
         return CANT_ALLOCATE_MEMORY_FOR_STACK;
 
-#if (CanaryProtection)
-    stack->data = (Elem_t *) (newData + sizeof(Canary));
+    STACK_WRITE_GUARD(stack)
+#if (WatchdogProtection)
+    stackWatchdogWait(stack);
+#endif
+    size_t oldBytes = (size_t) stack->capacity * sizeof(Elem_t);
+    size_t newBytes = newStackCapacity * sizeof(Elem_t);
+    if (newBytes > oldBytes)
+        error = stackBudgetAcquire(stack,
+                                   stack->budgetGroup,
+                                   newBytes - oldBytes);
+    if (error)
+        return error;
 
-    *(Canary *) newData = CANARY_START;
-    *(Canary *) (stack->data + newStackCapacity) = CANARY_END;
+    Elem_t *newData = (Elem_t *) stackReallocData(stack->data, newBytes);
 
-#else
-    stack->data = (Elem_t *) newData;
+    if (newData == nullptr)
+    {
+        if (newBytes > oldBytes)
+            stackBudgetRelease(stack->budgetGroup, newBytes - oldBytes);
+        return CANT_ALLOCATE_MEMORY_FOR_STACK;
+    }
+    if (newBytes < oldBytes)
+        stackBudgetRelease(stack->budgetGroup, oldBytes - newBytes);
+#if (HashProtection)
+    // chunk hashes of buffer which became small are never looked up again
+    if (stackHashIsChunked(oldBytes) and !stackHashIsChunked(newBytes))
+        stackHashForgetChunks(stack);
+#endif
+
+    stack->data = newData;
+    stack->generation++;
+    stack->capacity = (StackSize_t) newStackCapacity;
+#if (TraceRecording)
+    stackTraceRecord(stack, TRACE_RESIZE, (Elem_t) newStackCapacity);
 #endif
-    stack->capacity = newStackCapacity;
 #if (PoisonProtection)
     stackPoisonData(stack);
 #endif
+#if (AsanProtection)
+    stackAnnotateData(stack, stack->size);
+#endif
 
 #if (HashProtection)
-    stack->dataHash = stackHashBuffer(stack);
-    stack->hash = stackHash(stack);
+    stackUpdateHash(stack);
 #endif
 
     ASSERT_OK(stack, &error)
     return error;
 }
 
+STACK_COLD
 size_t stackResize(Stack *stack)
 {
     assert(stack != nullptr);
@@ -199,12 +339,13 @@ size_t stackResize(Stack *stack)
     }
     if (stack->size >= stack->capacity)
     {
-        size_t newStackCapacity = stack->capacity * 2;
+        size_t newStackCapacity = (size_t) stack->capacity * 2;
         error = stackResizeMemory(stack, newStackCapacity);
         return error;
     }
 
-    if (stack->size * 4 <= stack->capacity)
+    // realloc to zero bytes frees data, so capacity doesn't go below one
+    if ((size_t) stack->size * 4 <= stack->capacity and stack->capacity > 1)
     {
         size_t newStackCapacity = stack->capacity / 2;
         error = stackResizeMemory(stack, newStackCapacity);
@@ -216,34 +357,150 @@ size_t stackResize(Stack *stack)
     return error;
 }
 
+size_t stackPushMany(Stack *stack, const Elem_t *values, size_t count)
+{
+    assert(stack != nullptr);
+    assert(values != nullptr or count == 0);
+
+    STACK_WRITE_GUARD(stack)
+    size_t error = stackReserve(stack, (size_t) stack->size + count);
+    if (error)
+        return error;
+
+    if (count != 0)
+        memcpy(stack->data + stack->size, values, count * sizeof(Elem_t));
+
+    return stackSyncData(stack, (size_t) stack->size + count);
+}
+
+size_t stackPopMany(Stack *stack, Elem_t *values, size_t count)
+{
+    assert(stack != nullptr);
+    assert(values != nullptr or count == 0);
+
+    size_t error = STACK_NO_ERRORS;
+    ASSERT_OK(stack, &error)
+    if (error)
+        return error;
+
+    if (count > stack->size)
+        return STACK_IS_EMPTY;
+
+    STACK_WRITE_GUARD(stack)
+    for (size_t i = 0; i < count; i++)
+    {
+        values[i] = stack->data[stack->size - 1 - i];
+    }
+
+    error = stackSyncData(stack, stack->size - count);
+    if (!error and (size_t) stack->size * 4 <= stack->capacity)
+        error = stackResize(stack);
+
+    return error;
+}
+
+size_t stackReserve(Stack *stack, size_t numOfElements)
+{
+    assert(stack != nullptr);
+
+    size_t error = STACK_NO_ERRORS;
+
+    ASSERT_OK(stack, &error)
+
+    if (error)
+        return error;
+
+    if (numOfElements > stack->capacity)
+    {
+        size_t newStackCapacity = stack->capacity == 0 ? 1 : stack->capacity;
+        while (newStackCapacity < numOfElements)
+            newStackCapacity *= 2;
+
+        error = stackResizeMemory(stack, newStackCapacity);
+        if (error)
+            return error;
+    }
+
+#if (AsanProtection)
+    stackAnnotateData(stack, numOfElements);
+#endif
+    return error;
+}
+
+size_t stackSyncData(Stack *stack, size_t newSize)
+{
+    assert(stack != nullptr);
+
+    size_t error = STACK_NO_ERRORS;
+
+    if (newSize > stack->capacity)
+        return STACK_SIZE_MORE_THAN_CAPACITY;
+
+    STACK_WRITE_GUARD(stack)
+    stack->size = (StackSize_t) newSize;
+    stack->generation++;
+#if (PoisonProtection)
+    stackPoisonData(stack);
+#endif
+#if (AsanProtection)
+    stackAnnotateData(stack, newSize);
+#endif
+
+#if (HashProtection)
+    stackUpdateHash(stack);
+#endif
+
+    ASSERT_OK(stack, &error)
+
+    return error;
+}
+
 #if (HashProtection)
-size_t hashData(void *data, size_t size)
+STACK_NO_SANITIZE_ADDRESS size_t hashData(const void *data, size_t size)
 {
     assert(data != nullptr);
 
     size_t hash = 5381;
     for (size_t i = 0; i < size; i++)
     {
-        hash = 33 * hash + ((char *) data)[i];
+        hash = 33 * hash + ((const char *) data)[i];
     }
     return hash;
 }
 
 size_t stackHashBuffer(Stack *stack)
 {
-    return hashData((char *) stack->data,
-                    stack->capacity * sizeof(Elem_t));
+    size_t size = (size_t) stack->capacity * sizeof(Elem_t);
+    if (stackHashIsChunked(size))
+        return hashDataChunked(stack->data, size, nullptr);
+
+    return hashData((char *) stack->data, size);
+}
+
+void stackUpdateHash(Stack *stack)
+{
+    assert(stack != nullptr);
+
+    size_t size = (size_t) stack->capacity * sizeof(Elem_t);
+    if (stackHashIsChunked(size))
+        stack->dataHash = stackHashStoreChunks(stack);
+    else
+        stack->dataHash = hashData((char *) stack->data, size);
+
+    stack->hash = stackHash(stack);
 }
 
 size_t stackHash(Stack *stack)
 {
     assert(stack != nullptr);
 
-    size_t old_hash = stack->hash;
-    stack->hash = 0;
-    size_t hash = hashData(stack, sizeof(*stack));
-    stack->hash = old_hash;
-    return hash;
+    Stack copy = {};
+    memcpy((void *) &copy, (const void *) stack, sizeof(Stack));
+    copy.hash = 0;
+#if (WatchdogProtection)
+    copy.seq = 0;
+#endif
+    return hashData(&copy, sizeof(copy));
 }
 #endif
 
@@ -253,22 +510,27 @@ size_t stackDtor(Stack *stack)
 
     size_t error = STACK_NO_ERRORS;
 
+#if (WatchdogProtection)
+    stackWatchdogUnregister(stack);
+#endif
+
     ASSERT_OK(stack, &error)
 
     if (error)
         return error;
-# if (CanaryProtection)
-    free((char *) stack->data - sizeof(Canary));
-# else
-    free(stack->data);
-# endif
+#if (TraceRecording)
+    stackTraceRecord(stack, TRACE_DTOR, 0);
+#endif
+    stackFreeData(stack->data);
+    stackBudgetRelease(stack->budgetGroup,
+                       (size_t) stack->capacity * sizeof(Elem_t));
 
 #if (PoisonProtection)
     stack->data = (Elem_t *) POISON_PTR;
 #endif
 
-    stack->size = (size_t) POISON_INT_VALUE;
-    stack->capacity = (size_t) POISON_INT_VALUE;
+    stack->size = (StackSize_t) POISON_INT_VALUE;
+    stack->capacity = (StackSize_t) POISON_INT_VALUE;
 
     stack->alive = false;
 
@@ -278,6 +540,7 @@ size_t stackDtor(Stack *stack)
 #endif
 
 # if (HashProtection)
+    stackHashForgetChunks(stack);
     stack->hash = (size_t) POISON_INT_VALUE;
     stack->dataHash = (size_t) POISON_INT_VALUE;
 # endif
@@ -13,6 +13,14 @@
 
 typedef int Elem_t;
 typedef uint64_t Canary;
+typedef uint32_t StackSize_t;
+typedef uint32_t StackInfoId;
+typedef uint8_t StackBudgetGroup;
+
+const StackSize_t STACK_MAX_CAPACITY = UINT32_MAX >> 1;
+const size_t STACK_CACHE_LINE_SIZE = 64;
+const size_t STACK_MAX_CALLSITES = 4096;
+const StackInfoId STACK_UNKNOWN_INFO_ID = 0;
 #if (PoisonProtection)
 const Elem_t POISON_VALUE = INT_MAX;
 const Elem_t *const POISON_PTR = &POISON_VALUE;
@@ -20,6 +28,17 @@ const Elem_t *const POISON_PTR = &POISON_VALUE;
 const int POISON_INT_VALUE = -7;
 const char *const POISON_STRING = "1000-7";
 
+#define STACK_LIKELY(condition) __builtin_expect(!!(condition), 1)
+#define STACK_UNLIKELY(condition) __builtin_expect(!!(condition), 0)
+#define STACK_COLD __attribute__((cold, noinline))
+
+#if (AsanProtection)
+/// code that reads whole buffer on purpose (hashes, canaries, dumps)
+#define STACK_NO_SANITIZE_ADDRESS __attribute__((no_sanitize_address))
+#else
+#define STACK_NO_SANITIZE_ADDRESS
+#endif
+
 #if (CanaryProtection)
 const uint64_t CANARY_START = 0x8BADF00D;
 const uint64_t CANARY_END = 0xBAADF00D;
@@ -46,11 +65,18 @@ struct Stack
     Elem_t *data = nullptr;
 #endif
 
-    size_t capacity = 0;
-    size_t size = 0;
+    StackSize_t capacity = 0;
+    StackSize_t size = 0;
 
-    StackInfo info = {};
+    StackInfoId infoId = STACK_UNKNOWN_INFO_ID;
+#if (WatchdogProtection)
+    uint32_t seq = 0;
+#endif
+    /// changes on every modification of size or data, invalidates views
+    uint32_t generation = 0;
     bool alive = false;
+    /// group in which data buffer is accounted, see stack_budget.h
+    StackBudgetGroup budgetGroup = 0;
 #if (HashProtection)
     size_t dataHash = 0;
     size_t hash = 0;
@@ -84,8 +110,36 @@ enum Errors
     STACK_DATA_INCORRECT_HASH          = 1 << 17,
     STACK_POISONED_DATA                = 1 << 18,
     STACK_NULLPTR                      = 1 << 19,
+    STACK_RECORD_FRAME_CORRUPTED       = 1 << 20,
+    VM_INCORRECT_PROGRAM               = 1 << 21,
+    VM_DIVISION_BY_ZERO                = 1 << 22,
+    STACK_AGGREGATE_CORRUPTED          = 1 << 23,
+    STACK_TRACE_INCORRECT              = 1 << 24,
+    STACK_OVERFLOW                     = 1 << 25,
+    STACK_SEGMENT_CORRUPTED            = 1 << 26,
+    STACK_VIEW_INVALID                 = 1 << 27,
+    STACK_OVER_BUDGET                  = 1 << 28,
 };
 
+static_assert(sizeof(Stack) <= STACK_CACHE_LINE_SIZE,
+              "Stack header must fit in one cache line");
+
+/**
+ * @brief registers callsite info in global callsite table
+ *
+ * @param info info about callsite
+ * @return id of callsite, STACK_UNKNOWN_INFO_ID if table is full
+ */
+StackInfoId stackInfoRegister(StackInfo info);
+
+/**
+ * @brief gets callsite info by id
+ *
+ * @param id id of callsite
+ * @return pointer to info, never nullptr
+ */
+const StackInfo *stackInfoGet(StackInfoId id);
+
 /**
  * @brief constructor for stack
  *
@@ -107,27 +161,85 @@ size_t stackCtor__(Stack *stack, size_t numOfElements);
  */
 #define stackCtor(stack, numOfElements, error)                         \
 {                                                                      \
-    (stack)->info = {__LINE__, __FILE__, __PRETTY_FUNCTION__, #stack}; \
+    static const StackInfoId stackInfoId_ = stackInfoRegister(         \
+        {__LINE__, __FILE__, __PRETTY_FUNCTION__, #stack});            \
+    (stack)->infoId = stackInfoId_;                                    \
     *(error) = stackCtor__((stack), (numOfElements));                  \
 }
 
+/**
+ * @brief pushes element to stack with full verification and resize
+ *
+ * @param stack stack for pushing
+ * @param value pushing value
+ * @return error code
+ */
+size_t stackPushSlow(Stack *stack, Elem_t value);
+
+/**
+ * @brief extracts last element from stack with full verification and
+ * resize
+ *
+ * @param stack stack for extracting
+ * @param value variable for storing extracted element
+ * @return error code
+ */
+size_t stackPopSlow(Stack *stack, Elem_t *value);
+
 /**
  * @brief pushes element to stack
  *
+ * With InlineFastPath push into free capacity is done inline, everything
+ * else goes to stackPushSlow.
+ *
  * @param stack stack for pushing
  * @param value pushing value
  * @return error code
  */
-size_t stackPush(Stack *stack, Elem_t value);
+inline size_t stackPush(Stack *stack, Elem_t value)
+{
+    assert(stack != nullptr);
+
+#if (InlineFastPath)
+    // null data is left to verifier, it is checked without protections too
+    if (STACK_LIKELY(stack->alive and stack->data != nullptr
+        and stack->size < stack->capacity))
+    {
+        stack->data[stack->size++] = value;
+        stack->generation++;
+        return STACK_NO_ERRORS;
+    }
+#endif
+    return stackPushSlow(stack, value);
+}
 
 /**
  * @brief extract last element from stack
  *
+ * With InlineFastPath pop which doesn't shrink stack is done inline,
+ * everything else goes to stackPopSlow.
+ *
  * @param stack stack for extracting
  * @param value variable for storing extracted element
  * @return error code
  */
-size_t stackPop(Stack *stack, Elem_t *value);
+inline size_t stackPop(Stack *stack, Elem_t *value)
+{
+    assert(stack != nullptr);
+    assert(value != nullptr);
+
+#if (InlineFastPath)
+    if (STACK_LIKELY(stack->alive and stack->data != nullptr
+        and stack->size != 0
+        and ((size_t) stack->size - 1) * 4 > stack->capacity))
+    {
+        *value = stack->data[--stack->size];
+        stack->generation++;
+        return STACK_NO_ERRORS;
+    }
+#endif
+    return stackPopSlow(stack, value);
+}
 
 /**
  * @brief shrink stack to size
@@ -137,7 +249,49 @@ size_t stackPop(Stack *stack, Elem_t *value);
  */
 size_t stackShrinkToFit(Stack *stack);
 
+#if (PoisonProtection)
+/**
+ * @brief fills elements with poison
+ *
+ * @param data first element to poison
+ * @param count number of elements to poison
+ */
+void stackPoisonRange(Elem_t *data, size_t count);
+
+/**
+ * @brief poisons unused part of stack data
+ *
+ * @param stack stack to poison
+ */
 void stackPoisonData(Stack *stack);
+#endif
+
+#if (AsanProtection)
+/**
+ * @brief marks elements [0, writable) addressable and [writable, capacity)
+ * poisoned for AddressSanitizer
+ *
+ * @param stack stack to annotate
+ * @param writable number of elements which can be accessed
+ */
+void stackAnnotateData(Stack *stack, size_t writable);
+#endif
+
+/**
+ * @brief reallocates data buffer with canaries around it
+ *
+ * @param data buffer to reallocate or nullptr for new zeroed buffer
+ * @param dataSize new size of buffer in bytes
+ * @return new buffer or nullptr if can't allocate memory
+ */
+void *stackReallocData(void *data, size_t dataSize);
+
+/**
+ * @brief frees buffer allocated by stackReallocData
+ *
+ * @param data buffer to free
+ */
+void stackFreeData(void *data);
 
 /**
  * @brief resizes stack to certain len
@@ -156,6 +310,48 @@ size_t stackResizeMemory(Stack *stack, size_t newStackCapacity);
  */
 size_t stackResize(Stack *stack);
 
+/**
+ * @brief pushes array of elements to stack with one verification
+ *
+ * @param stack stack for pushing
+ * @param values elements to push, values[0] is pushed first
+ * @param count number of elements
+ * @return error code
+ */
+size_t stackPushMany(Stack *stack, const Elem_t *values, size_t count);
+
+/**
+ * @brief extracts several last elements from stack with one verification
+ *
+ * @param stack stack for extracting
+ * @param values array for extracted elements, values[0] was on top
+ * @param count number of elements
+ * @return error code
+ */
+size_t stackPopMany(Stack *stack, Elem_t *values, size_t count);
+
+/**
+ * @brief makes capacity at least numOfElements, data pointer can change
+ *
+ * With AsanProtection elements up to numOfElements stay writable until
+ * stackSyncData.
+ *
+ * @param stack stack for reserving
+ * @param numOfElements required capacity
+ * @return error code
+ */
+size_t stackReserve(Stack *stack, size_t numOfElements);
+
+/**
+ * @brief finishes direct writes to stack->data: sets size, poisons
+ * elements above it and updates hashes
+ *
+ * @param stack stack which data was changed
+ * @param newSize new number of elements
+ * @return error code
+ */
+size_t stackSyncData(Stack *stack, size_t newSize);
+
 #if (HashProtection)
 /**
  * @brief hashes data
@@ -164,7 +360,7 @@ size_t stackResize(Stack *stack);
  * @param size size of data
  * @return hash of data
  */
-size_t hashData(void *data, size_t size);
+STACK_NO_SANITIZE_ADDRESS size_t hashData(const void *data, size_t size);
 
 /**
  * @brief hashes stack data
@@ -181,6 +377,13 @@ size_t stackHashBuffer(Stack *stack);
  * @return hash of stack
  */
 size_t stackHash(Stack *stack);
+
+/**
+ * @brief recomputes and stores data hash and hash of stack
+ *
+ * @param stack stack to rehash
+ */
+void stackUpdateHash(Stack *stack);
 #endif
 
 /**
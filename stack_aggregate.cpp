@@ -0,0 +1,322 @@
+#include "stack_aggregate.h"
+#include "stack_verification.h"
+#include "stack_logs.h"
+#include "stack_watchdog.h"
+
+static void aggregateStackUpdateHash(AggregateStack *stack)
+{
+#if (HashProtection)
+    stack->hash = aggregateStackHash(stack);
+#else
+    (void) stack;
+#endif
+}
+
+static Elem_t aggregateStackTop(const Stack *stack)
+{
+    return stack->data[stack->size - 1];
+}
+
+size_t aggregateStackCtor__(AggregateStack *stack, size_t numOfElements)
+{
+    assert(stack != nullptr);
+
+    size_t error = STACK_NO_ERRORS;
+
+    stack->minStack.infoId = stack->stack.infoId;
+    stack->maxStack.infoId = stack->stack.infoId;
+
+    error |= stackCtor__(&stack->stack, numOfElements);
+    error |= stackCtor__(&stack->minStack, 0);
+    error |= stackCtor__(&stack->maxStack, 0);
+    if (error)
+        return error;
+
+    stack->sum = 0;
+    aggregateStackUpdateHash(stack);
+
+    AGGREGATE_ASSERT_OK(stack, &error)
+
+    return error;
+}
+
+size_t aggregateStackPush(AggregateStack *stack, Elem_t value)
+{
+    assert(stack != nullptr);
+
+    size_t error = STACK_NO_ERRORS;
+
+    AGGREGATE_ASSERT_OK(stack, &error)
+    if (error)
+        return error;
+
+    bool pushMin = stack->minStack.size == 0
+        or value <= aggregateStackTop(&stack->minStack);
+    bool pushMax = stack->maxStack.size == 0
+        or value >= aggregateStackTop(&stack->maxStack);
+
+    // aggregates grow first, so failed allocation leaves them consistent
+    if (pushMin)
+        error |= stackReserve(&stack->minStack,
+                              (size_t) stack->minStack.size + 1);
+    if (pushMax)
+        error |= stackReserve(&stack->maxStack,
+                              (size_t) stack->maxStack.size + 1);
+    if (!error)
+        error = stackPush(&stack->stack, value);
+    if (error)
+    {
+        error |= stackSyncData(&stack->minStack, stack->minStack.size);
+        error |= stackSyncData(&stack->maxStack, stack->maxStack.size);
+        aggregateStackUpdateHash(stack);
+        return error;
+    }
+
+    if (pushMin)
+        error |= stackPush(&stack->minStack, value);
+    if (pushMax)
+        error |= stackPush(&stack->maxStack, value);
+
+    stack->sum += value;
+    aggregateStackUpdateHash(stack);
+
+    return error;
+}
+
+size_t aggregateStackPop(AggregateStack *stack, Elem_t *value)
+{
+    assert(stack != nullptr);
+    assert(value != nullptr);
+
+    size_t error = STACK_NO_ERRORS;
+
+    AGGREGATE_ASSERT_OK(stack, &error)
+    if (error)
+        return error;
+
+    error = stackPop(&stack->stack, value);
+    if (error)
+        return error;
+
+    Elem_t aggregate = 0;
+    if (*value == aggregateStackTop(&stack->minStack))
+        error |= stackPop(&stack->minStack, &aggregate);
+
+    if (*value == aggregateStackTop(&stack->maxStack))
+        error |= stackPop(&stack->maxStack, &aggregate);
+
+    stack->sum -= *value;
+    aggregateStackUpdateHash(stack);
+
+    return error;
+}
+
+size_t aggregateStackPushMany(AggregateStack *stack,
+                              const Elem_t *values,
+                              size_t count)
+{
+    assert(stack != nullptr);
+    assert(values != nullptr or count == 0);
+
+    size_t error = STACK_NO_ERRORS;
+
+    AGGREGATE_ASSERT_OK(stack, &error)
+    if (error)
+        return error;
+
+    STACK_WRITE_GUARD(&stack->minStack)
+    STACK_WRITE_GUARD(&stack->maxStack)
+
+    size_t minSize = stack->minStack.size;
+    size_t maxSize = stack->maxStack.size;
+    Elem_t min = minSize ? aggregateStackTop(&stack->minStack) : INT_MAX;
+    Elem_t max = maxSize ? aggregateStackTop(&stack->maxStack) : INT_MIN;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (values[i] <= min)
+        {
+            min = values[i];
+            minSize++;
+        }
+        if (values[i] >= max)
+        {
+            max = values[i];
+            maxSize++;
+        }
+    }
+
+    // aggregates grow first, so failed allocation leaves them consistent
+    error |= stackReserve(&stack->minStack, minSize);
+    error |= stackReserve(&stack->maxStack, maxSize);
+    if (!error)
+        error = stackPushMany(&stack->stack, values, count);
+    if (error)
+    {
+        error |= stackSyncData(&stack->minStack, stack->minStack.size);
+        error |= stackSyncData(&stack->maxStack, stack->maxStack.size);
+        aggregateStackUpdateHash(stack);
+        return error;
+    }
+
+    minSize = stack->minStack.size;
+    maxSize = stack->maxStack.size;
+    for (size_t i = 0; i < count; i++)
+    {
+        Elem_t value = values[i];
+        if (minSize == 0 or value <= stack->minStack.data[minSize - 1])
+            stack->minStack.data[minSize++] = value;
+        if (maxSize == 0 or value >= stack->maxStack.data[maxSize - 1])
+            stack->maxStack.data[maxSize++] = value;
+        stack->sum += value;
+    }
+
+    error |= stackSyncData(&stack->minStack, minSize);
+    error |= stackSyncData(&stack->maxStack, maxSize);
+    aggregateStackUpdateHash(stack);
+
+    return error;
+}
+
+size_t aggregateStackPopMany(AggregateStack *stack,
+                             Elem_t *values,
+                             size_t count)
+{
+    assert(stack != nullptr);
+    assert(values != nullptr or count == 0);
+
+    size_t error = STACK_NO_ERRORS;
+
+    AGGREGATE_ASSERT_OK(stack, &error)
+    if (error)
+        return error;
+
+    error = stackPopMany(&stack->stack, values, count);
+    if (error)
+        return error;
+
+    STACK_WRITE_GUARD(&stack->minStack)
+    STACK_WRITE_GUARD(&stack->maxStack)
+
+    size_t minSize = stack->minStack.size;
+    size_t maxSize = stack->maxStack.size;
+    for (size_t i = 0; i < count; i++)
+    {
+        Elem_t value = values[i];
+        if (minSize != 0 and value == stack->minStack.data[minSize - 1])
+            minSize--;
+        if (maxSize != 0 and value == stack->maxStack.data[maxSize - 1])
+            maxSize--;
+        stack->sum -= value;
+    }
+
+    error |= stackSyncData(&stack->minStack, minSize);
+    error |= stackSyncData(&stack->maxStack, maxSize);
+    aggregateStackUpdateHash(stack);
+
+    return error;
+}
+
+size_t stackMin(AggregateStack *stack, Elem_t *value)
+{
+    assert(stack != nullptr);
+    assert(value != nullptr);
+
+    if (stack->minStack.size == 0)
+    {
+        *value = 0;
+        return STACK_IS_EMPTY;
+    }
+
+    *value = aggregateStackTop(&stack->minStack);
+    return STACK_NO_ERRORS;
+}
+
+size_t stackMax(AggregateStack *stack, Elem_t *value)
+{
+    assert(stack != nullptr);
+    assert(value != nullptr);
+
+    if (stack->maxStack.size == 0)
+    {
+        *value = 0;
+        return STACK_IS_EMPTY;
+    }
+
+    *value = aggregateStackTop(&stack->maxStack);
+    return STACK_NO_ERRORS;
+}
+
+size_t stackSum(AggregateStack *stack, int64_t *value)
+{
+    assert(stack != nullptr);
+    assert(value != nullptr);
+
+    *value = stack->sum;
+    return STACK_NO_ERRORS;
+}
+
+#if (HashProtection)
+size_t aggregateStackHash(AggregateStack *stack)
+{
+    assert(stack != nullptr);
+
+    size_t hashes[] = {
+        stackHash(&stack->stack),
+        stackHash(&stack->minStack),
+        stackHash(&stack->maxStack),
+        (size_t) stack->sum,
+    };
+    return hashData(hashes, sizeof(hashes));
+}
+#endif
+
+size_t aggregateStackVerifier(AggregateStack *stack)
+{
+    size_t error = STACK_NO_ERRORS;
+    if (stack == nullptr)
+    {
+        error |= STACK_NULLPTR;
+        return error;
+    }
+
+    error |= stackVerifier(&stack->stack);
+    error |= stackVerifier(&stack->minStack);
+    error |= stackVerifier(&stack->maxStack);
+    if (error)
+        return error;
+
+    if (stack->minStack.size > stack->stack.size
+        or stack->maxStack.size > stack->stack.size
+        or (stack->stack.size != 0) != (stack->minStack.size != 0)
+        or (stack->stack.size != 0) != (stack->maxStack.size != 0))
+        error |= STACK_AGGREGATE_CORRUPTED;
+
+#if (HashProtection)
+    if (stack->hash != aggregateStackHash(stack))
+        error |= STACK_INCORRECT_HASH;
+#endif
+
+    return error;
+}
+
+size_t aggregateStackDtor(AggregateStack *stack)
+{
+    assert(stack != nullptr);
+
+    size_t error = STACK_NO_ERRORS;
+
+    AGGREGATE_ASSERT_OK(stack, &error)
+    if (error)
+        return error;
+
+    error |= stackDtor(&stack->stack);
+    error |= stackDtor(&stack->minStack);
+    error |= stackDtor(&stack->maxStack);
+
+    stack->sum = POISON_INT_VALUE;
+#if (HashProtection)
+    stack->hash = (size_t) POISON_INT_VALUE;
+#endif
+
+    return error;
+}
@@ -0,0 +1,161 @@
+#ifndef STACK_AGGREGATE_H
+#define STACK_AGGREGATE_H
+
+#include "stack.h"
+
+/**
+ * @brief stack with running min, max and sum
+ *
+ * minStack and maxStack are monotonic: they keep only elements which were
+ * minimum (maximum) at the moment of push, so top of each is current
+ * aggregate.
+ */
+struct AggregateStack
+{
+    Stack stack = {};
+    Stack minStack = {};
+    Stack maxStack = {};
+    int64_t sum = 0;
+#if (HashProtection)
+    size_t hash = 0;
+#endif
+};
+
+/**
+ * @brief constructor for aggregate stack
+ *
+ * @param stack stack for constructing
+ * @param numOfElements number of elements in stack
+ * @return error code
+ */
+size_t aggregateStackCtor__(AggregateStack *stack, size_t numOfElements);
+
+/**
+ * @brief macro constructor for aggregate stack
+ *
+ * @param aggregate stack for constructing
+ * @param numOfElements number of elements in stack
+ * @param error error code
+ * @return void
+ */
+#define aggregateStackCtor(aggregate, numOfElements, error)            \
+{                                                                      \
+    static const StackInfoId stackInfoId_ = stackInfoRegister(         \
+        {__LINE__, __FILE__, __PRETTY_FUNCTION__, #aggregate});        \
+    (aggregate)->stack.infoId = stackInfoId_;                          \
+    *(error) = aggregateStackCtor__((aggregate), (numOfElements));     \
+}
+
+/**
+ * @brief pushes element and updates aggregates
+ *
+ * @param stack stack for pushing
+ * @param value pushing value
+ * @return error code
+ */
+size_t aggregateStackPush(AggregateStack *stack, Elem_t value);
+
+/**
+ * @brief extracts last element and updates aggregates
+ *
+ * @param stack stack for extracting
+ * @param value variable for storing extracted element
+ * @return error code
+ */
+size_t aggregateStackPop(AggregateStack *stack, Elem_t *value);
+
+/**
+ * @brief pushes array of elements and updates aggregates
+ *
+ * @param stack stack for pushing
+ * @param values elements to push, values[0] is pushed first
+ * @param count number of elements
+ * @return error code
+ */
+size_t aggregateStackPushMany(AggregateStack *stack,
+                              const Elem_t *values,
+                              size_t count);
+
+/**
+ * @brief extracts several last elements and updates aggregates
+ *
+ * @param stack stack for extracting
+ * @param values array for extracted elements, values[0] was on top
+ * @param count number of elements
+ * @return error code
+ */
+size_t aggregateStackPopMany(AggregateStack *stack,
+                             Elem_t *values,
+                             size_t count);
+
+/**
+ * @brief gets minimum of stack elements
+ *
+ * @param stack stack to check
+ * @param value variable for minimum
+ * @return error code
+ */
+size_t stackMin(AggregateStack *stack, Elem_t *value);
+
+/**
+ * @brief gets maximum of stack elements
+ *
+ * @param stack stack to check
+ * @param value variable for maximum
+ * @return error code
+ */
+size_t stackMax(AggregateStack *stack, Elem_t *value);
+
+/**
+ * @brief gets sum of stack elements
+ *
+ * @param stack stack to check
+ * @param value variable for sum
+ * @return error code
+ */
+size_t stackSum(AggregateStack *stack, int64_t *value);
+
+#if (HashProtection)
+/**
+ * @brief hashes aggregate stack with its aggregates
+ *
+ * @param stack stack to hash
+ * @return hash of stack
+ */
+size_t aggregateStackHash(AggregateStack *stack);
+#endif
+
+/**
+ * @brief checks if aggregate stack and its aggregates are correct
+ *
+ * @param stack stack for checking
+ * @return error code
+ */
+size_t aggregateStackVerifier(AggregateStack *stack);
+
+/**
+ * @brief destructor for aggregate stack
+ *
+ * @param stack stack for destructing
+ * @return error code
+ */
+size_t aggregateStackDtor(AggregateStack *stack);
+
+/**
+ * @brief macro for checking if aggregate stack is correct
+ *
+ * @param aggregate stack for checking
+ * @param error error code
+ */
+#define AGGREGATE_ASSERT_OK(aggregate, error)                          \
+{                                                                      \
+    *(error) = aggregateStackVerifier((aggregate));                    \
+    if (STACK_UNLIKELY(*(error)))                                      \
+    {                                                                  \
+        StackInfo info = {__LINE__, __FILE__, __PRETTY_FUNCTION__,     \
+                          #aggregate};                                 \
+        stackDump(&(aggregate)->stack, &(info), *(error), printElem_t);\
+    }                                                                  \
+}
+
+#endif
@@ -0,0 +1,382 @@
+#include "stack_batch.h"
+#include "stack_verification.h"
+#include "stack_logs.h"
+#include "stack_budget.h"
+#include "stack_simd.h"
+
+#include <algorithm>
+
+static size_t stackBatchDataBytes(const StackBatch *batch)
+{
+    return batch->count * batch->capacity * sizeof(Elem_t);
+}
+
+#if (HashProtection)
+static size_t stackBatchHash(const StackBatch *batch)
+{
+    StackBatch copy = {};
+    memcpy((void *) &copy, (const void *) batch, sizeof(StackBatch));
+    copy.hash = 0;
+    return hashData(&copy, sizeof(copy));
+}
+
+static void stackBatchUpdateHash(StackBatch *batch)
+{
+    batch->dataHash = hashData(batch->data, stackBatchDataBytes(batch));
+    batch->sizesHash = hashData(batch->sizes,
+                                batch->count * sizeof(StackSize_t));
+    batch->hash = stackBatchHash(batch);
+}
+#endif
+
+size_t stackBatchCtor__(StackBatch *batch, size_t count, size_t capacity)
+{
+    assert(batch != nullptr);
+
+    size_t error = STACK_NO_ERRORS;
+
+    if (count == 0 or capacity == 0 or capacity > STACK_MAX_CAPACITY
+        or count > SIZE_MAX / capacity / sizeof(Elem_t))
+        return CANT_ALLOCATE_MEMORY_FOR_STACK;
+
+    size_t bytes = count * capacity * sizeof(Elem_t);
+    error = stackBudgetAcquire(batch, STACK_BUDGET_DEFAULT_GROUP, bytes);
+    if (error)
+        return error;
+
+    batch->data = (Elem_t *) stackReallocData(nullptr, bytes);
+    batch->sizes = (StackSize_t *) calloc(count, sizeof(StackSize_t));
+    if (batch->data == nullptr or batch->sizes == nullptr)
+    {
+        stackFreeData(batch->data);
+        free(batch->sizes);
+        batch->data = nullptr;
+        batch->sizes = nullptr;
+        stackBudgetRelease(STACK_BUDGET_DEFAULT_GROUP, bytes);
+        return CANT_ALLOCATE_MEMORY_FOR_STACK;
+    }
+
+#if (CanaryProtection)
+    batch->canary_start = CANARY_START;
+    batch->canary_end = CANARY_END;
+#endif
+
+#if (PoisonProtection)
+    stackPoisonRange(batch->data, count * capacity);
+#endif
+
+    batch->count = count;
+    batch->capacity = (StackSize_t) capacity;
+    batch->generation = 0;
+    batch->alive = true;
+
+#if (HashProtection)
+    stackBatchUpdateHash(batch);
+#endif
+
+    BATCH_ASSERT_OK(batch, &error)
+
+    return error;
+}
+
+size_t stackBatchPush(StackBatch *batch,
+                      const Elem_t *values,
+                      const uint8_t *mask,
+                      uint8_t *failed)
+{
+    assert(batch != nullptr);
+    assert(values != nullptr);
+
+    size_t error = STACK_NO_ERRORS;
+
+    BATCH_ASSERT_OK(batch, &error)
+    if (error)
+        return error;
+
+    if (failed != nullptr)
+        memset(failed, 0, batch->count);
+
+    if (stackScatterPush(batch->data,
+                         batch->sizes,
+                         batch->count,
+                         batch->capacity,
+                         values,
+                         mask,
+                         failed))
+        error |= STACK_OVERFLOW;
+    batch->generation++;
+
+#if (HashProtection)
+    stackBatchUpdateHash(batch);
+#endif
+
+    size_t batchError = STACK_NO_ERRORS;
+    BATCH_ASSERT_OK(batch, &batchError)
+
+    return error | batchError;
+}
+
+size_t stackBatchPop(StackBatch *batch,
+                     Elem_t *values,
+                     const uint8_t *mask,
+                     uint8_t *failed)
+{
+    assert(batch != nullptr);
+    assert(values != nullptr);
+
+    size_t error = STACK_NO_ERRORS;
+
+    BATCH_ASSERT_OK(batch, &error)
+    if (error)
+        return error;
+
+    if (failed != nullptr)
+        memset(failed, 0, batch->count);
+
+    if (stackGatherPop(batch->data,
+                       batch->sizes,
+                       batch->count,
+                       batch->capacity,
+                       values,
+                       mask,
+                       failed))
+        error |= STACK_IS_EMPTY;
+    batch->generation++;
+
+#if (HashProtection)
+    stackBatchUpdateHash(batch);
+#endif
+
+    size_t batchError = STACK_NO_ERRORS;
+    BATCH_ASSERT_OK(batch, &batchError)
+
+    return error | batchError;
+}
+
+size_t stackBatchViewCreate(StackBatch *batch,
+                            size_t index,
+                            StackBatchView *view)
+{
+    assert(view != nullptr);
+
+    size_t error = STACK_NO_ERRORS;
+
+    *view = {};
+    BATCH_ASSERT_OK(batch, &error)
+    if (error)
+        return error;
+
+    assert(index < batch->count);
+
+    view->batch = batch;
+    view->data = batch->data + index * batch->capacity;
+    view->size = batch->sizes[index];
+    view->generation = batch->generation;
+
+    return error;
+}
+
+size_t stackBatchViewVerify(const StackBatchView *view)
+{
+    assert(view != nullptr);
+
+    const StackBatch *batch = view->batch;
+    if (batch == nullptr)
+        return STACK_NULLPTR;
+
+    if (!batch->alive or batch->generation != view->generation
+        or view->data < batch->data
+        or view->data + view->size
+            > batch->data + batch->count * batch->capacity)
+        return STACK_VIEW_INVALID;
+
+    return STACK_NO_ERRORS;
+}
+
+/**
+ * @brief finds first stack with too big size or poisoned element
+ *
+ * @return index of stack or batch->count if all stacks are correct
+ */
+static size_t stackBatchFindBroken(const StackBatch *batch)
+{
+    for (size_t i = 0; i < batch->count; i++)
+    {
+        size_t size = batch->sizes[i];
+        if (size > batch->capacity)
+            return i;
+#if (PoisonProtection)
+        if (stackFindPoison(batch->data + i * batch->capacity, size) != size)
+            return i;
+#endif
+    }
+    return batch->count;
+}
+
+size_t stackBatchVerifier(StackBatch *batch)
+{
+    size_t error = STACK_NO_ERRORS;
+    if (batch == nullptr)
+    {
+        error |= STACK_NULLPTR;
+        return error;
+    }
+
+    if (!batch->alive)
+    {
+        error |= STACK_NOT_ALIVE;
+        return error;
+    }
+
+#if (PoisonProtection)
+    if (batch->data == POISON_PTR or batch->data == nullptr
+        or batch->sizes == nullptr)
+#else
+    if (batch->data == nullptr or batch->sizes == nullptr)
+#endif
+    {
+        error |= STACK_POISON_PTR_ERR;
+        return error;
+    }
+
+    StackSize_t maxSize = 0;
+    for (size_t i = 0; i < batch->count; i++)
+        maxSize = std::max(maxSize, batch->sizes[i]);
+    if (maxSize > batch->capacity)
+    {
+        error |= STACK_SIZE_MORE_THAN_CAPACITY;
+        return error;
+    }
+
+#if (PoisonProtection)
+    if (stackBatchFindBroken(batch) != batch->count)
+        error |= STACK_POISONED_DATA;
+#endif
+
+#if (HashProtection)
+    if (batch->dataHash != hashData(batch->data, stackBatchDataBytes(batch))
+        or batch->sizesHash != hashData(batch->sizes,
+                                        batch->count * sizeof(StackSize_t)))
+        error |= STACK_DATA_INCORRECT_HASH;
+
+    if (batch->hash != stackBatchHash(batch))
+        error |= STACK_INCORRECT_HASH;
+#endif
+
+#if (CanaryProtection)
+    stackVerifyStructCanaries(batch->canary_start, batch->canary_end, &error);
+    stackVerifyDataCanaries(batch->data, stackBatchDataBytes(batch), &error);
+#endif
+
+    return error;
+}
+
+STACK_COLD
+void stackBatchDump(StackBatch *batch, StackInfo *info, size_t error)
+{
+    if (!stackDumpThrottle(batch, info, error))
+        return;
+
+    if (STACK_LOG_FILE == nullptr)
+        STACK_LOG_FILE = stderr;
+
+    logStack(STACK_LOG_FILE, "-----START LOGGING STACK BATCH-----\n");
+    if (batch == nullptr)
+    {
+        logStack(STACK_LOG_FILE,
+                 "Can't log stack with pointer == nullptr\n");
+        logStack(STACK_LOG_FILE, "-----END LOGGING STACK BATCH-----\n");
+        return;
+    }
+
+    const StackInfo *stackInfo = stackInfoGet(batch->infoId);
+    logStack(STACK_LOG_FILE, "Error code %zu.\n", error);
+    if (info != nullptr)
+        logStack(STACK_LOG_FILE,
+                 "Error in stack '%s' in function '%s' at %s (%d)\n",
+                 info->name,
+                 info->initFunction,
+                 info->initFile,
+                 info->initLine);
+    logStack(STACK_LOG_FILE,
+             "Stack [%p] '%s' was initialized at %s at %s (%d)\n",
+             batch,
+             stackInfo->name,
+             stackInfo->initFunction,
+             stackInfo->initFile,
+             stackInfo->initLine);
+
+    if (error & (STACK_NOT_ALIVE | STACK_POISON_PTR_ERR))
+    {
+        processError(error);
+        logStack(STACK_LOG_FILE, "-----END LOGGING STACK BATCH-----\n");
+        return;
+    }
+
+    logStack(STACK_LOG_FILE, "{\n"
+                             "    Stacks = %zu \n"
+                             "    Capacity = %zu \n"
+                             "    Generation = %u \n"
+                             "    Data [%p] \n"
+                             "    Sizes [%p] \n",
+             batch->count,
+             (size_t) batch->capacity,
+             batch->generation,
+             batch->data,
+             batch->sizes);
+
+    size_t broken = stackBatchFindBroken(batch);
+    if (broken != batch->count)
+    {
+        size_t size = batch->sizes[broken];
+        logStack(STACK_LOG_FILE,
+                 "    First broken stack %zu, size %zu \n",
+                 broken,
+                 size);
+        printData(batch->data + broken * batch->capacity,
+                  std::min(size, (size_t) batch->capacity),
+                  true);
+    }
+    logStack(STACK_LOG_FILE, "}\n");
+
+    processError(error);
+    logStack(STACK_LOG_FILE, "-----END LOGGING STACK BATCH-----\n");
+}
+
+size_t stackBatchDtor(StackBatch *batch)
+{
+    assert(batch != nullptr);
+
+    size_t error = STACK_NO_ERRORS;
+
+    BATCH_ASSERT_OK(batch, &error)
+    if (error)
+        return error;
+
+    stackBudgetRelease(STACK_BUDGET_DEFAULT_GROUP, stackBatchDataBytes(batch));
+    stackFreeData(batch->data);
+    free(batch->sizes);
+
+#if (PoisonProtection)
+    batch->data = (Elem_t *) POISON_PTR;
+#else
+    batch->data = nullptr;
+#endif
+    batch->sizes = nullptr;
+    batch->count = 0;
+    batch->capacity = (StackSize_t) POISON_INT_VALUE;
+    batch->generation++;
+    batch->alive = false;
+
+#if (CanaryProtection)
+    batch->canary_start = CANARY_POISONED;
+    batch->canary_end = CANARY_POISONED;
+#endif
+
+#if (HashProtection)
+    batch->hash = (size_t) POISON_INT_VALUE;
+    batch->dataHash = (size_t) POISON_INT_VALUE;
+    batch->sizesHash = (size_t) POISON_INT_VALUE;
+#endif
+    return error;
+}
@@ -0,0 +1,182 @@
+#ifndef STACK_BATCH_H
+#define STACK_BATCH_H
+
+#include "stack.h"
+
+/**
+ * @brief many small stacks of same capacity in structure-of-arrays form
+ *
+ * Stack i keeps its elements in data[i * capacity ... i * capacity +
+ * sizes[i]). Whole batch is verified once per batch operation instead of
+ * once per stack. Push and pop go through stackScatterPush and
+ * stackGatherPop, which handle 8 or 16 stacks per instruction with AVX2
+ * or AVX-512. Buffer has data canaries like buffer of Stack, free cells
+ * are poisoned.
+ */
+struct StackBatch
+{
+#if (CanaryProtection)
+    Canary canary_start = CANARY_START;
+#endif
+
+    Elem_t *data = nullptr;
+    StackSize_t *sizes = nullptr;
+    size_t count = 0;
+    StackSize_t capacity = 0;
+
+    StackInfoId infoId = STACK_UNKNOWN_INFO_ID;
+    /// changes on every batch operation, invalidates views
+    uint32_t generation = 0;
+    bool alive = false;
+#if (HashProtection)
+    size_t dataHash = 0;
+    size_t sizesHash = 0;
+    size_t hash = 0;
+#endif
+
+#if (CanaryProtection)
+    Canary canary_end = CANARY_END;
+#endif
+};
+
+/**
+ * @brief read-only view of live elements of one stack of batch, from
+ * bottom to top, valid until next batch operation
+ */
+struct StackBatchView
+{
+    const StackBatch *batch = nullptr;
+    const Elem_t *data = nullptr;
+    size_t size = 0;
+    uint32_t generation = 0;
+
+    const Elem_t *begin() const
+    {
+        return data;
+    }
+
+    const Elem_t *end() const
+    {
+        return data + size;
+    }
+};
+
+/**
+ * @brief constructor for batch of empty stacks
+ *
+ * @param batch batch for constructing
+ * @param count number of stacks
+ * @param capacity max number of elements in each stack
+ * @return error code
+ */
+size_t stackBatchCtor__(StackBatch *batch, size_t count, size_t capacity);
+
+/**
+ * @brief macro constructor for batch of stacks
+ *
+ * @param batch batch for constructing
+ * @param count number of stacks
+ * @param capacity max number of elements in each stack
+ * @param error error code
+ * @return void
+ */
+#define stackBatchCtor(batch, count, capacity, error)                  \
+{                                                                      \
+    static const StackInfoId stackInfoId_ = stackInfoRegister(         \
+        {__LINE__, __FILE__, __PRETTY_FUNCTION__, #batch});            \
+    (batch)->infoId = stackInfoId_;                                    \
+    *(error) = stackBatchCtor__((batch), (count), (capacity));         \
+}
+
+/**
+ * @brief pushes values[i] to stack i for every stack selected by mask
+ *
+ * @param batch batch for pushing
+ * @param values count values, one for each stack
+ * @param mask count flags, nullptr selects all stacks
+ * @param failed count flags set for full stacks, can be nullptr
+ * @return error code, STACK_OVERFLOW if some stack is full
+ */
+size_t stackBatchPush(StackBatch *batch,
+                      const Elem_t *values,
+                      const uint8_t *mask,
+                      uint8_t *failed);
+
+/**
+ * @brief extracts top of stack i to values[i] for every stack selected by
+ * mask
+ *
+ * @param batch batch for extracting
+ * @param values count variables, value of empty stack is set to 0
+ * @param mask count flags, nullptr selects all stacks
+ * @param failed count flags set for empty stacks, can be nullptr
+ * @return error code, STACK_IS_EMPTY if some stack is empty
+ */
+size_t stackBatchPop(StackBatch *batch,
+                     Elem_t *values,
+                     const uint8_t *mask,
+                     uint8_t *failed);
+
+/**
+ * @brief verifies batch and creates view of one stack
+ *
+ * @param batch batch of stacks
+ * @param index index of stack
+ * @param view view to fill
+ * @return error code
+ */
+size_t stackBatchViewCreate(StackBatch *batch,
+                            size_t index,
+                            StackBatchView *view);
+
+/**
+ * @brief checks that batch wasn't modified since view was created
+ *
+ * @param view view to check
+ * @return STACK_VIEW_INVALID if view is stale
+ */
+size_t stackBatchViewVerify(const StackBatchView *view);
+
+/**
+ * @brief checks if batch is correct
+ *
+ * @param batch batch for checking
+ * @return error code
+ */
+size_t stackBatchVerifier(StackBatch *batch);
+
+/**
+ * @brief generates dump of batch with elements of first broken stack
+ *
+ * @param batch batch for dumping
+ * @param info struct with info about callsite
+ * @param error error code
+ */
+void stackBatchDump(StackBatch *batch, StackInfo *info, size_t error);
+
+/**
+ * @brief destructor for batch
+ *
+ * @param batch batch for destructing
+ * @return error code
+ */
+size_t stackBatchDtor(StackBatch *batch);
+
+/**
+ * @brief macro for checking if batch is correct
+ *
+ * @param batch batch for checking
+ * @param error error code
+ */
+#define BATCH_ASSERT_OK(batch, error)                                  \
+{                                                                      \
+    *(error) = stackBatchVerifier((batch));                            \
+    if (STACK_UNLIKELY(*(error)))                                      \
+    {                                                                  \
+        StackInfo info = {__LINE__, __FILE__, __PRETTY_FUNCTION__,     \
+                          #batch};                                     \
+        stackBatchDump((batch), &(info), *(error));                    \
+    }                                                                  \
+}
+
+#endif
@@ -0,0 +1,178 @@
+#include "stack_budget.h"
+#include "stack_verification.h"
+#include "stack_logs.h"
+
+#include <atomic>
+
+struct StackBudgetCounters
+{
+    std::atomic<size_t> bytes{0};
+    std::atomic<size_t> highWater{0};
+    std::atomic<size_t> limit{STACK_BUDGET_UNLIMITED};
+    std::atomic<size_t> softExceeded{0};
+    std::atomic<size_t> failures{0};
+};
+
+static StackBudgetCounters STACK_BUDGET_TOTAL;
+static StackBudgetCounters STACK_BUDGET[STACK_BUDGET_GROUPS];
+static std::atomic<StackBudgetTrimmer> STACK_BUDGET_TRIMMER(nullptr);
+
+static StackBudgetCounters *stackBudgetCounters(StackBudgetGroup group)
+{
+    if (group == STACK_BUDGET_ALL_GROUPS)
+        return &STACK_BUDGET_TOTAL;
+
+    assert(group < STACK_BUDGET_GROUPS);
+    return &STACK_BUDGET[group];
+}
+
+static void stackBudgetRaiseHighWater(StackBudgetCounters *counters,
+                                      size_t bytes)
+{
+    size_t highWater = counters->highWater.load(std::memory_order_relaxed);
+    while (highWater < bytes
+           and !counters->highWater.compare_exchange_weak(
+               highWater, bytes, std::memory_order_relaxed))
+        ;
+}
+
+static void stackBudgetTrim(const void *stack,
+                            StackBudgetGroup group,
+                            size_t bytes)
+{
+    StackBudgetTrimmer trimmer = STACK_BUDGET_TRIMMER.load();
+    if (trimmer != nullptr)
+        trimmer(stack, group, bytes);
+}
+
+void stackBudgetSetLimit(size_t bytes)
+{
+    STACK_BUDGET_TOTAL.limit.store(bytes);
+}
+
+void stackBudgetSetGroupLimit(StackBudgetGroup group, size_t bytes)
+{
+    stackBudgetCounters(group)->limit.store(bytes);
+}
+
+void stackBudgetSetTrimmer(StackBudgetTrimmer trimmer)
+{
+    STACK_BUDGET_TRIMMER.store(trimmer);
+}
+
+size_t stackBudgetAcquire(const void *stack,
+                          StackBudgetGroup group,
+                          size_t bytes)
+{
+    StackBudgetCounters *counters = stackBudgetCounters(group);
+
+    size_t softLimit = counters->limit.load(std::memory_order_relaxed);
+    if (softLimit != STACK_BUDGET_UNLIMITED
+        and counters->bytes.load(std::memory_order_relaxed) + bytes
+            > softLimit)
+    {
+        counters->softExceeded.fetch_add(1, std::memory_order_relaxed);
+        stackBudgetTrim(stack,
+                        group,
+                        counters->bytes.load(std::memory_order_relaxed)
+                            + bytes - softLimit);
+    }
+
+    bool trimmed = false;
+    size_t total = STACK_BUDGET_TOTAL.bytes.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        size_t limit = STACK_BUDGET_TOTAL.limit.load(
+            std::memory_order_relaxed);
+        if (limit != STACK_BUDGET_UNLIMITED and total + bytes > limit)
+        {
+            if (trimmed)
+            {
+                counters->failures.fetch_add(1, std::memory_order_relaxed);
+                STACK_BUDGET_TOTAL.failures.fetch_add(
+                    1, std::memory_order_relaxed);
+                return STACK_OVER_BUDGET;
+            }
+
+            stackBudgetTrim(stack, STACK_BUDGET_ALL_GROUPS,
+                            total + bytes - limit);
+            trimmed = true;
+            total = STACK_BUDGET_TOTAL.bytes.load(std::memory_order_relaxed);
+            continue;
+        }
+
+        if (STACK_BUDGET_TOTAL.bytes.compare_exchange_weak(
+                total, total + bytes, std::memory_order_relaxed))
+            break;
+    }
+
+    stackBudgetRaiseHighWater(&STACK_BUDGET_TOTAL, total + bytes);
+    stackBudgetRaiseHighWater(counters,
+                              counters->bytes.fetch_add(
+                                  bytes, std::memory_order_relaxed) + bytes);
+
+    return STACK_NO_ERRORS;
+}
+
+void stackBudgetRelease(StackBudgetGroup group, size_t bytes)
+{
+    stackBudgetCounters(group)->bytes.fetch_sub(bytes,
+                                                std::memory_order_relaxed);
+    STACK_BUDGET_TOTAL.bytes.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+StackBudgetUsage stackBudgetGetUsage(StackBudgetGroup group)
+{
+    StackBudgetCounters *counters = stackBudgetCounters(group);
+
+    StackBudgetUsage usage = {};
+    usage.bytes = counters->bytes.load(std::memory_order_relaxed);
+    usage.highWater = counters->highWater.load(std::memory_order_relaxed);
+    usage.softExceeded =
+        counters->softExceeded.load(std::memory_order_relaxed);
+    usage.failures = counters->failures.load(std::memory_order_relaxed);
+    return usage;
+}
+
+void stackBudgetResetStats()
+{
+    StackBudgetCounters *all[STACK_BUDGET_GROUPS + 1] = {&STACK_BUDGET_TOTAL};
+    for (size_t group = 0; group < STACK_BUDGET_GROUPS; group++)
+        all[group + 1] = &STACK_BUDGET[group];
+
+    for (StackBudgetCounters *counters: all)
+    {
+        counters->highWater.store(counters->bytes.load());
+        counters->softExceeded.store(0);
+        counters->failures.store(0);
+    }
+}
+
+size_t stackBudgetSetGroup(Stack *stack, StackBudgetGroup group)
+{
+    assert(stack != nullptr);
+    assert(group < STACK_BUDGET_GROUPS);
+
+    size_t error = STACK_NO_ERRORS;
+
+    ASSERT_OK(stack, &error)
+    if (error)
+        return error;
+
+    size_t bytes = (size_t) stack->capacity * sizeof(Elem_t);
+    StackBudgetCounters *counters = stackBudgetCounters(group);
+    stackBudgetRaiseHighWater(counters,
+                              counters->bytes.fetch_add(
+                                  bytes, std::memory_order_relaxed) + bytes);
+    stackBudgetCounters(stack->budgetGroup)->bytes.fetch_sub(
+        bytes, std::memory_order_relaxed);
+
+    stack->budgetGroup = group;
+#if (HashProtection)
+    stackUpdateHash(stack);
+#endif
+
+    ASSERT_OK(stack, &error)
+
+    return error;
+}
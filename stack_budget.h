@@ -0,0 +1,104 @@
+#ifndef STACK_BUDGET_H
+#define STACK_BUDGET_H
+
+#include "stack.h"
+
+const size_t STACK_BUDGET_GROUPS = 16;
+const StackBudgetGroup STACK_BUDGET_DEFAULT_GROUP = 0;
+/// group passed to trimmer when process-wide limit is reached
+const StackBudgetGroup STACK_BUDGET_ALL_GROUPS = 0xFF;
+const size_t STACK_BUDGET_UNLIMITED = 0;
+
+/**
+ * @brief bytes of data buffers accounted to group or to whole process
+ */
+struct StackBudgetUsage
+{
+    size_t bytes = 0;
+    size_t highWater = 0;
+    /// number of acquires which went over soft limit of group
+    size_t softExceeded = 0;
+    /// number of acquires which failed with STACK_OVER_BUDGET
+    size_t failures = 0;
+};
+
+/**
+ * @brief callback which should free slack capacity of stacks, for example
+ * with stackShrinkToFit
+ *
+ * It is called from resize of stack resizing, which must not be touched.
+ * Group is STACK_BUDGET_ALL_GROUPS when process-wide limit is reached.
+ */
+typedef void (*StackBudgetTrimmer)(const void *resizing,
+                                   StackBudgetGroup group,
+                                   size_t bytes);
+
+/**
+ * @brief sets hard limit on data buffers of all stacks
+ *
+ * @param bytes limit in bytes, STACK_BUDGET_UNLIMITED to remove limit
+ */
+void stackBudgetSetLimit(size_t bytes);
+
+/**
+ * @brief sets soft limit of group, going over it calls trimmer but doesn't
+ * fail
+ *
+ * @param group group of stacks
+ * @param bytes limit in bytes, STACK_BUDGET_UNLIMITED to remove limit
+ */
+void stackBudgetSetGroupLimit(StackBudgetGroup group, size_t bytes);
+
+/**
+ * @brief sets callback for trimming stacks, nullptr to disable trimming
+ *
+ * @param trimmer callback
+ */
+void stackBudgetSetTrimmer(StackBudgetTrimmer trimmer);
+
+/**
+ * @brief accounts growth of data buffer before allocating it
+ *
+ * If hard limit would be exceeded, trimmer is called once for all groups
+ * and then limit is checked again.
+ *
+ * @param stack stack which grows, passed to trimmer
+ * @param group group of stack
+ * @param bytes growth in bytes
+ * @return error code, STACK_OVER_BUDGET if hard limit is exceeded
+ */
+size_t stackBudgetAcquire(const void *stack,
+                          StackBudgetGroup group,
+                          size_t bytes);
+
+/**
+ * @brief accounts freed or not allocated bytes of data buffer
+ *
+ * @param group group of stack
+ * @param bytes freed bytes
+ */
+void stackBudgetRelease(StackBudgetGroup group, size_t bytes);
+
+/**
+ * @brief gets usage of group, doesn't take locks
+ *
+ * @param group group of stacks or STACK_BUDGET_ALL_GROUPS for whole process
+ * @return usage of group
+ */
+StackBudgetUsage stackBudgetGetUsage(StackBudgetGroup group);
+
+/**
+ * @brief sets high-water marks to current usage and clears counters
+ */
+void stackBudgetResetStats();
+
+/**
+ * @brief moves stack and its accounted bytes to another group
+ *
+ * @param stack stack to move
+ * @param group new group
+ * @return error code
+ */
+size_t stackBudgetSetGroup(Stack *stack, StackBudgetGroup group);
+
+#endif
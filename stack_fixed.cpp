@@ -0,0 +1,76 @@
+#include "stack_fixed.h"
+#include "stack_logs.h"
+
+void fixedStackDump(const FixedStack *stack, StackInfo *info, size_t error)
+{
+    if (!stackDumpThrottle(stack, info, error))
+        return;
+
+    if (STACK_LOG_FILE == nullptr)
+        STACK_LOG_FILE = stderr;
+
+    logStack(STACK_LOG_FILE, "-----START LOGGING FIXED STACK-----\n");
+    if (stack == nullptr)
+    {
+        logStack(STACK_LOG_FILE,
+                 "Can't log stack with pointer == nullptr\n");
+        logStack(STACK_LOG_FILE, "-----END LOGGING FIXED STACK-----\n");
+        return;
+    }
+
+    const StackInfo *stackInfo = stackInfoGet(stack->infoId);
+    logStack(STACK_LOG_FILE, "Error code %zu.\n", error);
+    if (info != nullptr)
+        logStack(STACK_LOG_FILE,
+                 "Error in stack '%s' in function '%s' at %s (%d)\n",
+                 info->name,
+                 info->initFunction,
+                 info->initFile,
+                 info->initLine);
+    logStack(STACK_LOG_FILE,
+             "Stack [%p] '%s' was initialized at %s at %s (%d)\n",
+             stack,
+             stackInfo->name,
+             stackInfo->initFunction,
+             stackInfo->initFile,
+             stackInfo->initLine);
+
+    if (error & (STACK_NOT_ALIVE | STACK_SIZE_MORE_THAN_CAPACITY
+        | STACK_POISON_PTR_ERR))
+    {
+        processError(error);
+        logStack(STACK_LOG_FILE, "-----END LOGGING FIXED STACK-----\n");
+        return;
+    }
+
+#if (HashProtection)
+    logStack(STACK_LOG_FILE, "{\n"
+                             "    Size = %zu \n"
+                             "    Capacity = %zu \n"
+                             "    Stack hash = %zu \n"
+                             "    Correct stack hash = %zu \n"
+                             "    Data [%p] \n",
+             (size_t) stack->size,
+             (size_t) stack->capacity,
+             fixedStackHash(stack),
+             stack->hash,
+             stack->data);
+#else
+    logStack(STACK_LOG_FILE, "{\n"
+                             "    Size = %zu \n"
+                             "    Capacity = %zu \n"
+                             "    Data [%p] \n",
+             (size_t) stack->size,
+             (size_t) stack->capacity,
+             stack->data);
+#endif
+
+    printData(stack->data, stack->size, true);
+    printData(stack->data + stack->size,
+              stack->capacity - stack->size,
+              false);
+    logStack(STACK_LOG_FILE, "}\n");
+
+    processError(error);
+    logStack(STACK_LOG_FILE, "-----END LOGGING FIXED STACK-----\n");
+}
@@ -0,0 +1,367 @@
+#ifndef STACK_FIXED_H
+#define STACK_FIXED_H
+
+#include "stack.h"
+
+#if (CanaryProtection)
+const Elem_t FIXED_CANARY_START = (Elem_t) 0x0BADF00D;
+const Elem_t FIXED_CANARY_END = (Elem_t) 0x0BAADF00;
+const Elem_t FIXED_CANARY_POISONED = (Elem_t) 0x0DEADBEE;
+const size_t FIXED_STACK_CANARY_LENGTH = 1;
+#else
+const size_t FIXED_STACK_CANARY_LENGTH = 0;
+#endif
+
+/**
+ * @brief stack over caller buffer, never allocates memory
+ *
+ * Data canaries are Elem_t at both ends of buffer and hash is computed
+ * by elements, so all functions except dump can run in constant
+ * expressions.
+ */
+struct FixedStack
+{
+#if (CanaryProtection)
+    Canary canary_start = CANARY_START;
+#endif
+
+    Elem_t *data = nullptr;
+    StackSize_t capacity = 0;
+    StackSize_t size = 0;
+
+    StackInfoId infoId = STACK_UNKNOWN_INFO_ID;
+    bool alive = false;
+#if (HashProtection)
+    size_t hash = 0;
+#endif
+
+#if (CanaryProtection)
+    Canary canary_end = CANARY_END;
+#endif
+};
+
+/**
+ * @brief gets length of buffer needed for stack of certain capacity
+ *
+ * @param capacity max number of elements in stack
+ * @return length of buffer in elements
+ */
+constexpr size_t fixedStackBufferLength(size_t capacity)
+{
+    return capacity + 2 * FIXED_STACK_CANARY_LENGTH;
+}
+
+/**
+ * @brief fixed stack with buffer inside, must not be copied after
+ * constructing because stack.data points to buffer
+ */
+template <size_t Capacity>
+struct StaticStack
+{
+    Elem_t buffer[fixedStackBufferLength(Capacity)] = {};
+    FixedStack stack = {};
+};
+
+/**
+ * @brief generates dump of fixed stack
+ *
+ * @param stack stack for dumping
+ * @param info struct with info about callsite
+ * @param error error code
+ */
+void fixedStackDump(const FixedStack *stack, StackInfo *info, size_t error);
+
+#if (HashProtection)
+/**
+ * @brief hashes fields and live elements of fixed stack
+ *
+ * @param stack stack to hash
+ * @return hash of stack
+ */
+constexpr size_t fixedStackHash(const FixedStack *stack)
+{
+    assert(stack != nullptr);
+
+    size_t hash = 5381;
+    hash = 33 * hash + stack->capacity;
+    hash = 33 * hash + stack->size;
+    hash = 33 * hash + stack->infoId;
+    hash = 33 * hash + stack->alive;
+    for (size_t i = 0; i < stack->size; i++)
+        hash = 33 * hash + (size_t) stack->data[i];
+
+    return hash;
+}
+#endif
+
+/**
+ * @brief checks if fixed stack is correct
+ *
+ * @param stack stack for checking
+ * @return error code
+ */
+constexpr size_t fixedStackVerifier(const FixedStack *stack)
+{
+    size_t error = STACK_NO_ERRORS;
+    if (stack == nullptr)
+    {
+        error |= STACK_NULLPTR;
+        return error;
+    }
+
+    if (!stack->alive)
+    {
+        error |= STACK_NOT_ALIVE;
+        return error;
+    }
+
+    if (stack->size > stack->capacity)
+    {
+        error |= STACK_SIZE_MORE_THAN_CAPACITY;
+        return error;
+    }
+
+    if (stack->data == nullptr)
+    {
+        error |= STACK_POISON_PTR_ERR;
+        return error;
+    }
+
+#if (PoisonProtection)
+    for (size_t i = 0; i < stack->size; i++)
+    {
+        if (stack->data[i] == POISON_VALUE)
+        {
+            error |= STACK_POISONED_DATA;
+            break;
+        }
+    }
+#endif
+
+#if (HashProtection)
+    if (stack->hash != fixedStackHash(stack))
+        error |= STACK_INCORRECT_HASH;
+#endif
+
+#if (CanaryProtection)
+    if (stack->canary_start != CANARY_START)
+        error |= stack->canary_start == CANARY_POISONED
+            ? STACK_START_STRUCT_CANARY_POISONED
+            : STACK_START_STRUCT_CANARY_DEAD;
+    if (stack->canary_end != CANARY_END)
+        error |= stack->canary_end == CANARY_POISONED
+            ? STACK_END_STRUCT_CANARY_POISONED
+            : STACK_END_STRUCT_CANARY_DEAD;
+
+    if (stack->data[-1] != FIXED_CANARY_START)
+        error |= stack->data[-1] == FIXED_CANARY_POISONED
+            ? STACK_START_DATA_CANARY_POISONED
+            : STACK_START_DATA_CANARY_DEAD;
+    if (stack->data[stack->capacity] != FIXED_CANARY_END)
+        error |= stack->data[stack->capacity] == FIXED_CANARY_POISONED
+            ? STACK_END_DATA_CANARY_POISONED
+            : STACK_END_DATA_CANARY_DEAD;
+#endif
+
+    return error;
+}
+
+/**
+ * @brief macro for checking if fixed stack is correct
+ *
+ * @param stack stack for checking
+ * @param error error code
+ */
+#define FIXED_ASSERT_OK(stack, error)                                  \
+{                                                                      \
+    *(error) = fixedStackVerifier((stack));                            \
+    if (STACK_UNLIKELY(*(error)))                                      \
+    {                                                                  \
+        StackInfo info = {__LINE__, __FILE__, __func__, #stack};       \
+        fixedStackDump((stack), &(info), *(error));                    \
+    }                                                                  \
+}
+
+/**
+ * @brief constructor for fixed stack
+ *
+ * @param stack stack for constructing
+ * @param buffer buffer for data and canaries
+ * @param length length of buffer in elements
+ * @return error code
+ */
+constexpr size_t fixedStackCtor__(FixedStack *stack,
+                                  Elem_t *buffer,
+                                  size_t length)
+{
+    assert(stack != nullptr);
+
+    size_t error = STACK_NO_ERRORS;
+
+    if (buffer == nullptr
+        or length < fixedStackBufferLength(0)
+        or length > fixedStackBufferLength(STACK_MAX_CAPACITY))
+        return CANT_ALLOCATE_MEMORY_FOR_STACK;
+
+    stack->data = buffer + FIXED_STACK_CANARY_LENGTH;
+    stack->capacity = (StackSize_t) (length - fixedStackBufferLength(0));
+    stack->size = 0;
+    stack->alive = true;
+
+#if (CanaryProtection)
+    stack->canary_start = CANARY_START;
+    stack->canary_end = CANARY_END;
+    stack->data[-1] = FIXED_CANARY_START;
+    stack->data[stack->capacity] = FIXED_CANARY_END;
+#endif
+
+#if (PoisonProtection)
+    for (size_t i = 0; i < stack->capacity; i++)
+        stack->data[i] = POISON_VALUE;
+#endif
+
+#if (HashProtection)
+    stack->hash = fixedStackHash(stack);
+#endif
+
+    FIXED_ASSERT_OK(stack, &error)
+
+    return error;
+}
+
+/**
+ * @brief macro constructor for fixed stack
+ *
+ * @param stack stack for constructing
+ * @param buffer buffer for data and canaries
+ * @param length length of buffer in elements
+ * @param error error code
+ * @return void
+ */
+#define fixedStackCtor(stack, buffer, length, error)                   \
+{                                                                      \
+    static const StackInfoId stackInfoId_ = stackInfoRegister(         \
+        {__LINE__, __FILE__, __PRETTY_FUNCTION__, #stack});            \
+    (stack)->infoId = stackInfoId_;                                    \
+    *(error) = fixedStackCtor__((stack), (buffer), (length));          \
+}
+
+/**
+ * @brief constructor for static stack
+ *
+ * @param stack stack for constructing
+ * @return error code
+ */
+template <size_t Capacity>
+constexpr size_t staticStackCtor(StaticStack<Capacity> *stack)
+{
+    assert(stack != nullptr);
+
+    return fixedStackCtor__(&stack->stack,
+                            stack->buffer,
+                            fixedStackBufferLength(Capacity));
+}
+
+/**
+ * @brief pushes element to fixed stack
+ *
+ * @param stack stack for pushing
+ * @param value pushing value
+ * @return error code, STACK_OVERFLOW if stack is full
+ */
+constexpr size_t fixedStackPush(FixedStack *stack, Elem_t value)
+{
+    assert(stack != nullptr);
+
+    size_t error = STACK_NO_ERRORS;
+
+    FIXED_ASSERT_OK(stack, &error)
+    if (error)
+        return error;
+
+    if (stack->size == stack->capacity)
+        return STACK_OVERFLOW;
+
+    stack->data[stack->size++] = value;
+#if (HashProtection)
+    stack->hash = fixedStackHash(stack);
+#endif
+
+    FIXED_ASSERT_OK(stack, &error)
+
+    return error;
+}
+
+/**
+ * @brief extracts last element from fixed stack
+ *
+ * @param stack stack for extracting
+ * @param value variable for storing extracted element
+ * @return error code
+ */
+constexpr size_t fixedStackPop(FixedStack *stack, Elem_t *value)
+{
+    assert(stack != nullptr);
+    assert(value != nullptr);
+
+    size_t error = STACK_NO_ERRORS;
+
+    FIXED_ASSERT_OK(stack, &error)
+    if (error)
+        return error;
+
+    if (stack->size == 0)
+    {
+        *value = 0;
+        return STACK_IS_EMPTY;
+    }
+
+    stack->size--;
+    *value = stack->data[stack->size];
+#if (PoisonProtection)
+    stack->data[stack->size] = POISON_VALUE;
+#endif
+#if (HashProtection)
+    stack->hash = fixedStackHash(stack);
+#endif
+
+    FIXED_ASSERT_OK(stack, &error)
+
+    return error;
+}
+
+/**
+ * @brief destructor for fixed stack, buffer is left to caller
+ *
+ * @param stack stack for destructing
+ * @return error code
+ */
+constexpr size_t fixedStackDtor(FixedStack *stack)
+{
+    assert(stack != nullptr);
+
+    size_t error = STACK_NO_ERRORS;
+
+    FIXED_ASSERT_OK(stack, &error)
+    if (error)
+        return error;
+
+#if (CanaryProtection)
+    stack->data[-1] = FIXED_CANARY_POISONED;
+    stack->data[stack->capacity] = FIXED_CANARY_POISONED;
+    stack->canary_start = CANARY_POISONED;
+    stack->canary_end = CANARY_POISONED;
+#endif
+
+    stack->data = nullptr;
+    stack->size = (StackSize_t) POISON_INT_VALUE;
+    stack->capacity = (StackSize_t) POISON_INT_VALUE;
+    stack->alive = false;
+
+#if (HashProtection)
+    stack->hash = (size_t) POISON_INT_VALUE;
+#endif
+    return error;
+}
+
+#endif
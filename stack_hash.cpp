@@ -0,0 +1,256 @@
+#include "stack_hash.h"
+
+#if (HashProtection)
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <pthread.h>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct StackHashJob
+{
+    const char *data = nullptr;
+    size_t size = 0;
+    size_t chunkSize = 0;
+    size_t chunks = 0;
+    size_t *hashes = nullptr;
+    std::atomic<size_t> next{0};
+};
+
+static StackHashConfig STACK_HASH_CONFIG = {};
+
+static std::mutex STACK_HASH_JOB_MUTEX;
+static std::mutex STACK_HASH_POOL_MUTEX;
+static std::condition_variable STACK_HASH_POOL_WAKE;
+static std::condition_variable STACK_HASH_POOL_DONE;
+static std::vector<std::thread> STACK_HASH_WORKERS;
+static StackHashJob STACK_HASH_JOB;
+static size_t STACK_HASH_GENERATION = 0;
+static size_t STACK_HASH_BUSY_WORKERS = 0;
+static bool STACK_HASH_STOP = false;
+
+static std::mutex STACK_HASH_CHUNKS_MUTEX;
+static std::unordered_map<const Stack *, std::vector<size_t>>
+    STACK_HASH_CHUNKS;
+
+static void stackHashRunJob(StackHashJob *job)
+{
+    for (size_t chunk = job->next++; chunk < job->chunks;
+         chunk = job->next++)
+    {
+        size_t begin = chunk * job->chunkSize;
+        size_t size = job->size - begin < job->chunkSize
+                      ? job->size - begin
+                      : job->chunkSize;
+        job->hashes[chunk] = hashData(job->data + begin, size);
+    }
+}
+
+static void stackHashWorker(size_t generation)
+{
+    std::unique_lock<std::mutex> lock(STACK_HASH_POOL_MUTEX);
+    while (true)
+    {
+        STACK_HASH_POOL_WAKE.wait(lock, [&generation]
+        {
+            return STACK_HASH_STOP or STACK_HASH_GENERATION != generation;
+        });
+        if (STACK_HASH_STOP)
+            return;
+
+        generation = STACK_HASH_GENERATION;
+        lock.unlock();
+        stackHashRunJob(&STACK_HASH_JOB);
+        lock.lock();
+
+        if (--STACK_HASH_BUSY_WORKERS == 0)
+            STACK_HASH_POOL_DONE.notify_all();
+    }
+}
+
+static void stackHashStopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(STACK_HASH_POOL_MUTEX);
+        STACK_HASH_STOP = true;
+    }
+    STACK_HASH_POOL_WAKE.notify_all();
+    for (std::thread &worker: STACK_HASH_WORKERS)
+        worker.join();
+
+    STACK_HASH_WORKERS.clear();
+    STACK_HASH_STOP = false;
+}
+
+static void stackHashForkPrepare()
+{
+    STACK_HASH_JOB_MUTEX.lock();
+    STACK_HASH_POOL_MUTEX.lock();
+    STACK_HASH_CHUNKS_MUTEX.lock();
+}
+
+static void stackHashForkParent()
+{
+    STACK_HASH_CHUNKS_MUTEX.unlock();
+    STACK_HASH_POOL_MUTEX.unlock();
+    STACK_HASH_JOB_MUTEX.unlock();
+}
+
+/**
+ * @brief forgets workers in forked child, fork copies only calling thread,
+ * so child hashes on it
+ */
+static void stackHashForkChild()
+{
+    // handles of threads which don't exist are leaked, join would hang
+    new std::vector<std::thread>(std::move(STACK_HASH_WORKERS));
+    STACK_HASH_WORKERS.clear();
+    STACK_HASH_BUSY_WORKERS = 0;
+    STACK_HASH_STOP = false;
+
+    stackHashForkParent();
+}
+
+void stackHashConfigure(StackHashConfig config)
+{
+    std::lock_guard<std::mutex> jobLock(STACK_HASH_JOB_MUTEX);
+
+    if (config.threads == 0)
+        config.threads = 1;
+    if (config.chunkSize == 0)
+        config.chunkSize = STACK_HASH_CHUNK_SIZE;
+
+    stackHashStopWorkers();
+    STACK_HASH_CONFIG = config;
+    for (unsigned i = 1; i < config.threads; i++)
+        STACK_HASH_WORKERS.emplace_back(stackHashWorker,
+                                        STACK_HASH_GENERATION);
+
+    static bool stopAtExit = false;
+    if (!stopAtExit)
+    {
+        stopAtExit = true;
+        atexit(stackHashStopWorkers);
+        pthread_atfork(stackHashForkPrepare,
+                       stackHashForkParent,
+                       stackHashForkChild);
+    }
+}
+
+StackHashConfig stackHashGetConfig()
+{
+    return STACK_HASH_CONFIG;
+}
+
+bool stackHashIsChunked(size_t size)
+{
+    return size > STACK_HASH_CONFIG.threshold;
+}
+
+size_t stackHashChunksCount(size_t size)
+{
+    return (size + STACK_HASH_CONFIG.chunkSize - 1)
+        / STACK_HASH_CONFIG.chunkSize;
+}
+
+size_t hashDataChunked(const void *data, size_t size, size_t *chunkHashes)
+{
+    assert(data != nullptr);
+
+    size_t chunks = stackHashChunksCount(size);
+    std::vector<size_t> hashes;
+    if (chunkHashes == nullptr)
+    {
+        hashes.resize(chunks);
+        chunkHashes = hashes.data();
+    }
+
+    std::unique_lock<std::mutex> jobLock(STACK_HASH_JOB_MUTEX,
+                                         std::try_to_lock);
+    if (!jobLock.owns_lock() or STACK_HASH_WORKERS.empty())
+    {
+        StackHashJob job = {};
+        job.data = (const char *) data;
+        job.size = size;
+        job.chunkSize = STACK_HASH_CONFIG.chunkSize;
+        job.chunks = chunks;
+        job.hashes = chunkHashes;
+        stackHashRunJob(&job);
+    }
+    else
+    {
+        {
+            std::lock_guard<std::mutex> lock(STACK_HASH_POOL_MUTEX);
+            STACK_HASH_JOB.data = (const char *) data;
+            STACK_HASH_JOB.size = size;
+            STACK_HASH_JOB.chunkSize = STACK_HASH_CONFIG.chunkSize;
+            STACK_HASH_JOB.chunks = chunks;
+            STACK_HASH_JOB.hashes = chunkHashes;
+            STACK_HASH_JOB.next = 0;
+            STACK_HASH_BUSY_WORKERS = STACK_HASH_WORKERS.size();
+            STACK_HASH_GENERATION++;
+        }
+        STACK_HASH_POOL_WAKE.notify_all();
+        stackHashRunJob(&STACK_HASH_JOB);
+
+        std::unique_lock<std::mutex> lock(STACK_HASH_POOL_MUTEX);
+        STACK_HASH_POOL_DONE.wait(lock, []
+        {
+            return STACK_HASH_BUSY_WORKERS == 0;
+        });
+    }
+
+    return hashData(chunkHashes, chunks * sizeof(size_t));
+}
+
+size_t stackHashStoreChunks(const Stack *stack)
+{
+    assert(stack != nullptr);
+
+    size_t size = (size_t) stack->capacity * sizeof(Elem_t);
+    std::vector<size_t> hashes(stackHashChunksCount(size));
+    size_t hash = hashDataChunked(stack->data, size, hashes.data());
+
+    std::lock_guard<std::mutex> lock(STACK_HASH_CHUNKS_MUTEX);
+    STACK_HASH_CHUNKS[stack].swap(hashes);
+    return hash;
+}
+
+void stackHashForgetChunks(const Stack *stack)
+{
+    std::lock_guard<std::mutex> lock(STACK_HASH_CHUNKS_MUTEX);
+    STACK_HASH_CHUNKS.erase(stack);
+}
+
+size_t stackFindCorruptedChunk(const Stack *stack)
+{
+    assert(stack != nullptr);
+
+    size_t size = (size_t) stack->capacity * sizeof(Elem_t);
+    if (!stackHashIsChunked(size))
+        return STACK_NO_CORRUPTED_CHUNK;
+
+    std::vector<size_t> stored;
+    {
+        std::lock_guard<std::mutex> lock(STACK_HASH_CHUNKS_MUTEX);
+        auto found = STACK_HASH_CHUNKS.find(stack);
+        if (found == STACK_HASH_CHUNKS.end())
+            return STACK_NO_CORRUPTED_CHUNK;
+        stored = found->second;
+    }
+
+    std::vector<size_t> hashes(stackHashChunksCount(size));
+    if (hashes.size() != stored.size())
+        return STACK_NO_CORRUPTED_CHUNK;
+
+    hashDataChunked(stack->data, size, hashes.data());
+    for (size_t i = 0; i < hashes.size(); i++)
+    {
+        if (hashes[i] != stored[i])
+            return i;
+    }
+    return STACK_NO_CORRUPTED_CHUNK;
+}
+#endif
@@ -0,0 +1,86 @@
+#ifndef STACK_HASH_H
+#define STACK_HASH_H
+
+#include "stack.h"
+
+#if (HashProtection)
+const size_t STACK_PARALLEL_HASH_THRESHOLD = 16 << 20;
+const size_t STACK_HASH_CHUNK_SIZE = 1 << 20;
+const size_t STACK_NO_CORRUPTED_CHUNK = SIZE_MAX;
+
+struct StackHashConfig
+{
+    unsigned threads = 1;
+    size_t threshold = STACK_PARALLEL_HASH_THRESHOLD;
+    size_t chunkSize = STACK_HASH_CHUNK_SIZE;
+};
+
+/**
+ * @brief sets number of hashing threads and chunking parameters
+ *
+ * Changing threshold or chunkSize changes hashes of big buffers, so it
+ * must be done while there are no stacks bigger than threshold.
+ *
+ * @param config new config
+ */
+void stackHashConfigure(StackHashConfig config);
+
+/**
+ * @brief gets current hashing config
+ *
+ * @return current config
+ */
+StackHashConfig stackHashGetConfig();
+
+/**
+ * @brief checks if buffer of this size is hashed by chunks
+ *
+ * @param size size of buffer in bytes
+ * @return true if buffer is hashed by chunks
+ */
+bool stackHashIsChunked(size_t size);
+
+/**
+ * @brief gets number of chunks in buffer
+ *
+ * @param size size of buffer in bytes
+ * @return number of chunks
+ */
+size_t stackHashChunksCount(size_t size);
+
+/**
+ * @brief hashes buffer by chunks on worker threads, root hash is hash of
+ * chunk hashes
+ *
+ * @param data data to hash
+ * @param size size of data
+ * @param chunkHashes array for hashes of chunks, can be nullptr
+ * @return root hash
+ */
+size_t hashDataChunked(const void *data, size_t size, size_t *chunkHashes);
+
+/**
+ * @brief hashes stack data by chunks and remembers chunk hashes
+ *
+ * @param stack stack to hash
+ * @return root hash of stack data
+ */
+size_t stackHashStoreChunks(const Stack *stack);
+
+/**
+ * @brief forgets remembered chunk hashes of stack
+ *
+ * @param stack stack to forget
+ */
+void stackHashForgetChunks(const Stack *stack);
+
+/**
+ * @brief finds first chunk of stack data which differs from remembered
+ *
+ * @param stack stack to check
+ * @return index of chunk or STACK_NO_CORRUPTED_CHUNK
+ */
+size_t stackFindCorruptedChunk(const Stack *stack);
+#endif
+
+#endif
@@ -1,8 +1,68 @@
 #include "stack_logs.h"
 #include "stack_verification.h"
+#include "stack_hash.h"
+#include "stack_simd.h"
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+#include <sys/wait.h>
+#include <unistd.h>
 
 FILE *STACK_LOG_FILE = stderr;
 
+struct StackDumpKey
+{
+    const void *stack = nullptr;
+    const char *file = nullptr;
+    const char *function = nullptr;
+    int line = 0;
+    size_t error = 0;
+
+    bool operator==(const StackDumpKey &other) const
+    {
+        return stack == other.stack and file == other.file
+            and function == other.function and line == other.line
+            and error == other.error;
+    }
+};
+
+struct StackDumpKeyHash
+{
+    size_t operator()(const StackDumpKey &key) const
+    {
+        size_t hash = std::hash<const void *>()(key.stack);
+        hash = 33 * hash + std::hash<const void *>()(key.file);
+        hash = 33 * hash + std::hash<const void *>()(key.function);
+        hash = 33 * hash + (size_t) key.line;
+        return 33 * hash + key.error;
+    }
+};
+
+struct StackDumpEntry
+{
+    size_t count = 0;
+    size_t dumps = 0;
+};
+
+const size_t STACK_DUMP_MAX_KEYS = STACK_MAX_CALLSITES;
+
+static std::mutex STACK_DUMP_MUTEX;
+static std::unordered_map<StackDumpKey, StackDumpEntry, StackDumpKeyHash>
+    STACK_DUMP_SEEN;
+static StackDumpLimits STACK_DUMP_LIMITS = {};
+static StackDumpStats STACK_DUMP_STATS = {};
+static pid_t STACK_DUMP_CHILDREN[STACK_DUMP_MAX_CHILDREN] = {};
+static size_t STACK_DUMP_CHILDREN_COUNT = 0;
+/// logfile of forked child, its dump is buffered in STACK_LOG_FILE
+static FILE *STACK_DUMP_CHILD_LOG = nullptr;
+static char *STACK_DUMP_CHILD_BUFFER = nullptr;
+static size_t STACK_DUMP_CHILD_BUFFER_SIZE = 0;
+static int64_t STACK_DUMP_SECOND = -1;
+static size_t STACK_DUMP_SECOND_FULL = 0;
+static size_t STACK_DUMP_SECOND_LINES = 0;
+
 void setLogFile(const char *filename)
 {
     if (filename == nullptr)
@@ -18,8 +78,283 @@ void setLogFile(const char *filename)
 
 void closeLogFile()
 {
-    if (STACK_LOG_FILE != nullptr)
+    if (STACK_LOG_FILE == nullptr)
+        return;
+
+    stackDumpWaitChildren();
+    stackDumpSummary();
+    if (STACK_LOG_FILE != stderr)
         fclose(STACK_LOG_FILE);
+    STACK_LOG_FILE = stderr;
+}
+
+void stackDumpConfigure(StackDumpLimits limits)
+{
+    std::lock_guard<std::mutex> lock(STACK_DUMP_MUTEX);
+    STACK_DUMP_LIMITS = limits;
+    STACK_DUMP_STATS = {};
+    STACK_DUMP_SEEN.clear();
+    STACK_DUMP_SECOND = -1;
+}
+
+StackDumpStats stackDumpGetStats()
+{
+    std::lock_guard<std::mutex> lock(STACK_DUMP_MUTEX);
+    return STACK_DUMP_STATS;
+}
+
+bool stackDumpThrottle(const void *stack, const StackInfo *info, size_t error)
+{
+    StackDumpKey key = {};
+    key.stack = stack;
+    key.error = error;
+    if (info != nullptr)
+    {
+        key.file = info->initFile;
+        key.function = info->initFunction;
+        key.line = info->initLine;
+    }
+
+    int64_t second = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    std::lock_guard<std::mutex> lock(STACK_DUMP_MUTEX);
+    if (second != STACK_DUMP_SECOND)
+    {
+        STACK_DUMP_SECOND = second;
+        STACK_DUMP_SECOND_FULL = 0;
+        STACK_DUMP_SECOND_LINES = 0;
+    }
+
+    StackDumpEntry *entry = nullptr;
+    auto seen = STACK_DUMP_SEEN.find(key);
+    if (seen != STACK_DUMP_SEEN.end())
+        entry = &seen->second;
+    else if (STACK_DUMP_SEEN.size() < STACK_DUMP_MAX_KEYS)
+        entry = &STACK_DUMP_SEEN[key];
+
+    // repeats of untracked error can't be counted, so only per-second
+    // limits apply to it
+    if (entry == nullptr)
+    {
+        STACK_DUMP_STATS.untracked++;
+        if (STACK_DUMP_SECOND_FULL < STACK_DUMP_LIMITS.fullPerSecond)
+        {
+            STACK_DUMP_SECOND_FULL++;
+            STACK_DUMP_STATS.full++;
+            return true;
+        }
+        if (STACK_DUMP_SECOND_LINES < STACK_DUMP_LIMITS.linesPerSecond)
+        {
+            STACK_DUMP_SECOND_LINES++;
+            STACK_DUMP_STATS.lines++;
+            if (STACK_LOG_FILE == nullptr)
+                STACK_LOG_FILE = stderr;
+            logStack(STACK_LOG_FILE,
+                     "Error %zu in stack [%p] at %s (%d), too many "
+                     "different errors to count repeats\n",
+                     key.error,
+                     key.stack,
+                     key.file == nullptr ? POISON_STRING : key.file,
+                     key.line);
+            return false;
+        }
+        STACK_DUMP_STATS.suppressed++;
+        return false;
+    }
+    entry->count++;
+
+    if (entry->dumps == 0)
+    {
+        if (STACK_DUMP_SECOND_FULL < STACK_DUMP_LIMITS.fullPerSecond)
+        {
+            STACK_DUMP_SECOND_FULL++;
+            STACK_DUMP_STATS.full++;
+            entry->dumps++;
+            return true;
+        }
+    }
+    else if ((entry->count & (entry->count - 1)) == 0
+        and STACK_DUMP_SECOND_LINES < STACK_DUMP_LIMITS.linesPerSecond)
+    {
+        STACK_DUMP_SECOND_LINES++;
+        STACK_DUMP_STATS.lines++;
+        if (STACK_LOG_FILE == nullptr)
+            STACK_LOG_FILE = stderr;
+        logStack(STACK_LOG_FILE,
+                 "Error %zu in stack [%p] at %s (%d) repeated %zu times\n",
+                 key.error,
+                 key.stack,
+                 key.file == nullptr ? POISON_STRING : key.file,
+                 key.line,
+                 entry->count);
+        return false;
+    }
+
+    STACK_DUMP_STATS.suppressed++;
+    return false;
+}
+
+/**
+ * @brief forgets finished dump children, must be called under
+ * STACK_DUMP_MUTEX
+ */
+static void stackDumpReapChildren()
+{
+    size_t running = 0;
+    for (size_t i = 0; i < STACK_DUMP_CHILDREN_COUNT; i++)
+    {
+        pid_t pid = STACK_DUMP_CHILDREN[i];
+        int status = 0;
+        if (waitpid(pid, &status, WNOHANG) == 0)
+            STACK_DUMP_CHILDREN[running++] = pid;
+    }
+    STACK_DUMP_CHILDREN_COUNT = running;
+}
+
+size_t stackDumpWaitChildren()
+{
+    pid_t children[STACK_DUMP_MAX_CHILDREN] = {};
+    size_t running = 0;
+    {
+        std::lock_guard<std::mutex> lock(STACK_DUMP_MUTEX);
+        running = STACK_DUMP_CHILDREN_COUNT;
+        std::copy(STACK_DUMP_CHILDREN,
+                  STACK_DUMP_CHILDREN + running,
+                  children);
+    }
+
+    // waiting under mutex would block dumps of other threads
+    for (size_t i = 0; i < running; i++)
+    {
+        int status = 0;
+        waitpid(children[i], &status, 0);
+    }
+
+    std::lock_guard<std::mutex> lock(STACK_DUMP_MUTEX);
+    stackDumpReapChildren();
+    return running;
+}
+
+StackDumpMode stackDumpFork(const void *stack,
+                            const StackInfo *info,
+                            size_t error)
+{
+    {
+        std::lock_guard<std::mutex> lock(STACK_DUMP_MUTEX);
+        if (STACK_DUMP_LIMITS.forkChildren == 0)
+            return STACK_DUMP_HERE;
+
+        stackDumpReapChildren();
+        if (STACK_DUMP_CHILDREN_COUNT
+            < std::min(STACK_DUMP_LIMITS.forkChildren,
+                       STACK_DUMP_MAX_CHILDREN))
+        {
+            if (STACK_LOG_FILE == nullptr)
+                STACK_LOG_FILE = stderr;
+            fflush(STACK_LOG_FILE);
+
+            pid_t pid = fork();
+            if (pid == 0)
+            {
+                // kills child if it got locked stdio or malloc from fork
+                alarm(STACK_DUMP_CHILD_TIMEOUT);
+
+                // dump is written by one write, so parent and other
+                // children can't get into the middle of it
+                STACK_DUMP_CHILD_LOG = STACK_LOG_FILE;
+                FILE *buffer = open_memstream(&STACK_DUMP_CHILD_BUFFER,
+                                              &STACK_DUMP_CHILD_BUFFER_SIZE);
+                if (buffer != nullptr)
+                    STACK_LOG_FILE = buffer;
+                return STACK_DUMP_CHILD;
+            }
+            if (pid > 0)
+            {
+                STACK_DUMP_CHILDREN[STACK_DUMP_CHILDREN_COUNT++] = pid;
+                STACK_DUMP_STATS.forked++;
+                return STACK_DUMP_SKIP;
+            }
+        }
+        STACK_DUMP_STATS.compact++;
+    }
+
+    if (STACK_LOG_FILE == nullptr)
+        STACK_LOG_FILE = stderr;
+    logStack(STACK_LOG_FILE,
+             "Error %zu in stack [%p] at %s in %s (%d), full dump skipped\n",
+             error,
+             stack,
+             info == nullptr ? POISON_STRING : info->initFile,
+             info == nullptr ? POISON_STRING : info->initFunction,
+             info == nullptr ? POISON_INT_VALUE : info->initLine);
+    processError(error);
+    return STACK_DUMP_SKIP;
+}
+
+void stackDumpForkEnd(StackDumpMode mode)
+{
+    if (mode != STACK_DUMP_CHILD)
+        return;
+
+    if (STACK_LOG_FILE != STACK_DUMP_CHILD_LOG)
+    {
+        fclose(STACK_LOG_FILE);
+        int fd = fileno(STACK_DUMP_CHILD_LOG);
+        const char *data = STACK_DUMP_CHILD_BUFFER;
+        size_t size = STACK_DUMP_CHILD_BUFFER_SIZE;
+        while (size != 0)
+        {
+            ssize_t written = write(fd, data, size);
+            if (written <= 0)
+                break;
+            data += written;
+            size -= (size_t) written;
+        }
+    }
+    else if (STACK_LOG_FILE != nullptr)
+    {
+        fflush(STACK_LOG_FILE);
+    }
+    _exit(0);
+}
+
+void stackDumpSummary()
+{
+    std::lock_guard<std::mutex> lock(STACK_DUMP_MUTEX);
+    if (STACK_LOG_FILE == nullptr or STACK_DUMP_SEEN.empty())
+        return;
+
+    logStack(STACK_LOG_FILE, "-----START DUMP SUMMARY-----\n");
+    for (const auto &seen: STACK_DUMP_SEEN)
+    {
+        if (seen.second.count < 2)
+            continue;
+
+        logStack(STACK_LOG_FILE,
+                 "Error %zu in stack [%p] at %s (%d): %zu times, %zu dumped\n",
+                 seen.first.error,
+                 seen.first.stack,
+                 seen.first.file == nullptr ? POISON_STRING : seen.first.file,
+                 seen.first.line,
+                 seen.second.count,
+                 seen.second.dumps);
+    }
+    logStack(STACK_LOG_FILE,
+             "Full dumps %zu, one-line repeats %zu, suppressed %zu\n",
+             STACK_DUMP_STATS.full,
+             STACK_DUMP_STATS.lines,
+             STACK_DUMP_STATS.suppressed);
+    if (STACK_DUMP_STATS.untracked != 0)
+        logStack(STACK_LOG_FILE,
+                 "Errors without counted repeats %zu\n",
+                 STACK_DUMP_STATS.untracked);
+    if (STACK_DUMP_STATS.forked != 0 or STACK_DUMP_STATS.compact != 0)
+        logStack(STACK_LOG_FILE,
+                 "Forked dumps %zu, compact dumps %zu\n",
+                 STACK_DUMP_STATS.forked,
+                 STACK_DUMP_STATS.compact);
+    logStack(STACK_LOG_FILE, "-----END DUMP SUMMARY-----\n");
 }
 
 void printElem_t(FILE *fp, Elem_t value)
@@ -42,6 +377,7 @@ void logStack(FILE *fp, const char *formatString, ...)
     va_end(args);
 }
 
+STACK_NO_SANITIZE_ADDRESS
 void printData(Elem_t *data,
                size_t size,
                bool alive,
@@ -64,10 +400,10 @@ void printData(Elem_t *data,
     }
 }
 
-void stackDump(Stack *stack,
-               StackInfo *info,
-               size_t error,
-               void (*print)(FILE *, Elem_t))
+static void stackDumpFull(Stack *stack,
+                          StackInfo *info,
+                          size_t error,
+                          void (*print)(FILE *, Elem_t))
 {
     if (STACK_LOG_FILE == nullptr)
         STACK_LOG_FILE = stderr;
@@ -99,6 +435,7 @@ void stackDump(Stack *stack,
     }
     else
     {
+        const StackInfo *stackInfo = stackInfoGet(stack->infoId);
         logStack(STACK_LOG_FILE, "Error code %zu.\n", error);
         logStack(STACK_LOG_FILE,
                  "Error in stack '%s' in function '%s' at %s (%d)\n",
@@ -110,17 +447,23 @@ void stackDump(Stack *stack,
         logStack(STACK_LOG_FILE,
                  "Stack [%p] '%s' was initialized at %s at %s (%d)\n",
                  stack,
-                 stack->info.name,
-                 stack->info.initFunction,
-                 stack->info.initFile,
-                 stack->info.initLine);
+                 stackInfo->name,
+                 stackInfo->initFunction,
+                 stackInfo->initFile,
+                 stackInfo->initLine);
     }
-    if (error & STACK_POISONED_DATA or error & STACK_POISON_PTR_ERR)
+    if (error & STACK_POISON_PTR_ERR)
     {
         logStack(STACK_LOG_FILE,
                  "Data is nullptr. Can't log stack data.");
         return;
     }
+#if (PoisonProtection)
+    if (error & STACK_POISONED_DATA)
+        logStack(STACK_LOG_FILE,
+                 "First poisoned element [%zu]\n",
+                 stackFindPoison(stack->data, stack->size));
+#endif
 
 # if (HashProtection)
     logStack(STACK_LOG_FILE, "{\n"
@@ -131,20 +474,32 @@ void stackDump(Stack *stack,
                              "    Stack data hash = %zu \n"
                              "    Correct stack data hash = %zu \n"
                              "    Data [%p] \n",
-             stack->size,
-             stack->capacity,
+             (size_t) stack->size,
+             (size_t) stack->capacity,
              stackHash(stack),
              stack->hash,
              stackHashBuffer(stack),
              stack->dataHash,
              stack->data);
+
+    if (error & STACK_DATA_INCORRECT_HASH)
+    {
+        size_t chunk = stackFindCorruptedChunk(stack);
+        size_t chunkSize = stackHashGetConfig().chunkSize;
+        if (chunk != STACK_NO_CORRUPTED_CHUNK)
+            logStack(STACK_LOG_FILE,
+                     "    Corrupted data chunk %zu, elements [%zu, %zu) \n",
+                     chunk,
+                     chunk * chunkSize / sizeof(Elem_t),
+                     (chunk + 1) * chunkSize / sizeof(Elem_t));
+    }
 #else
     logStack(STACK_LOG_FILE, "{\n"
                  "    Size = %zu \n"
                  "    Capacity = %zu \n"
                  "    Data [%p] \n",
-             stack->size,
-             stack->capacity,
+             (size_t) stack->size,
+             (size_t) stack->capacity,
              stack->data);
 #endif
 
@@ -173,6 +528,23 @@ void stackDump(Stack *stack,
     logStack(STACK_LOG_FILE, "-----END LOGGING STACK-----\n");
 }
 
+STACK_COLD
+void stackDump(Stack *stack,
+               StackInfo *info,
+               size_t error,
+               void (*print)(FILE *, Elem_t))
+{
+    if (!stackDumpThrottle(stack, info, error))
+        return;
+
+    StackDumpMode mode = stackDumpFork(stack, info, error);
+    if (mode == STACK_DUMP_SKIP)
+        return;
+
+    stackDumpFull(stack, info, error, print);
+    stackDumpForkEnd(mode);
+}
+
 void processError(size_t error)
 {
     if (!error)
@@ -249,4 +621,40 @@ void processError(size_t error)
     if (error & STACK_NULLPTR)
         logStack(STACK_LOG_FILE,
                  "Got stack nullptr.\n");
+
+    if (error & STACK_RECORD_FRAME_CORRUPTED)
+        logStack(STACK_LOG_FILE,
+                 "Record frame was corrupted.\n");
+
+    if (error & VM_INCORRECT_PROGRAM)
+        logStack(STACK_LOG_FILE,
+                 "Incorrect VM program.\n");
+
+    if (error & VM_DIVISION_BY_ZERO)
+        logStack(STACK_LOG_FILE,
+                 "Division by zero in VM program.\n");
+
+    if (error & STACK_AGGREGATE_CORRUPTED)
+        logStack(STACK_LOG_FILE,
+                 "Aggregates of stack don't match its data.\n");
+
+    if (error & STACK_TRACE_INCORRECT)
+        logStack(STACK_LOG_FILE,
+                 "Can't write or read stack trace.\n");
+
+    if (error & STACK_OVERFLOW)
+        logStack(STACK_LOG_FILE,
+                 "Stack is full. Can't push.\n");
+
+    if (error & STACK_SEGMENT_CORRUPTED)
+        logStack(STACK_LOG_FILE,
+                 "Spilled segment of stack was corrupted.\n");
+
+    if (error & STACK_VIEW_INVALID)
+        logStack(STACK_LOG_FILE,
+                 "Stack was modified after view was created.\n");
+
+    if (error & STACK_OVER_BUDGET)
+        logStack(STACK_LOG_FILE,
+                 "Stack memory budget is exceeded.\n");
 }
@@ -4,6 +4,42 @@
 #include "stack.h"
 #include "stack_verification.h"
 
+extern FILE *STACK_LOG_FILE;
+
+const size_t STACK_DUMP_MAX_CHILDREN = 16;
+const unsigned STACK_DUMP_CHILD_TIMEOUT = 10;
+
+/**
+ * @brief limits for dumps, one-line repeats are printed when count of
+ * same error reaches power of two
+ */
+struct StackDumpLimits
+{
+    size_t fullPerSecond = 16;
+    size_t linesPerSecond = 64;
+    /// max number of running forked dumps, 0 writes full dumps in caller
+    size_t forkChildren = 0;
+};
+
+struct StackDumpStats
+{
+    size_t full = 0;
+    size_t lines = 0;
+    size_t suppressed = 0;
+    /// errors which didn't fit table of seen errors
+    size_t untracked = 0;
+    size_t forked = 0;
+    /// full dumps replaced by summary because of forkChildren limit
+    size_t compact = 0;
+};
+
+enum StackDumpMode
+{
+    STACK_DUMP_SKIP  = 0,
+    STACK_DUMP_HERE  = 1,
+    STACK_DUMP_CHILD = 2,
+};
+
 /**
  * @brief sets logfile
  *
@@ -12,10 +48,76 @@
 void setLogFile(const char *filename);
 
 /**
- * @brief closes logfile
+ * @brief writes dump summary and closes logfile
  */
 void closeLogFile();
 
+/**
+ * @brief sets dump limits and forgets all seen errors
+ *
+ * @param limits new limits
+ */
+void stackDumpConfigure(StackDumpLimits limits);
+
+/**
+ * @brief gets counters of written and suppressed dumps
+ *
+ * @return dump counters
+ */
+StackDumpStats stackDumpGetStats();
+
+/**
+ * @brief decides if dump should be written
+ *
+ * Errors are grouped by stack address, callsite and error code. First
+ * error of group gets full dump, repeats get one-line count.
+ *
+ * @param stack stack which is dumped
+ * @param info struct with info about callsite
+ * @param error error code
+ * @return true if full dump should be written
+ */
+bool stackDumpThrottle(const void *stack, const StackInfo *info, size_t error);
+
+/**
+ * @brief decides where full dump is written
+ *
+ * With forkChildren limit full dump is written by forked child from
+ * copy-on-write snapshot of process, so caller doesn't wait for it. Child
+ * formats dump in memory and stackDumpForkEnd writes it to logfile at
+ * once. When limit is reached or fork fails, compact summary is written
+ * instead.
+ *
+ * @param stack stack which is dumped
+ * @param info struct with info about callsite
+ * @param error error code
+ * @return STACK_DUMP_HERE or STACK_DUMP_CHILD if full dump should be
+ * written, STACK_DUMP_SKIP otherwise
+ */
+StackDumpMode stackDumpFork(const void *stack,
+                            const StackInfo *info,
+                            size_t error);
+
+/**
+ * @brief writes buffered dump to logfile and exits forked child, does
+ * nothing in caller
+ *
+ * @param mode value returned by stackDumpFork
+ */
+void stackDumpForkEnd(StackDumpMode mode);
+
+/**
+ * @brief waits for all running forked dumps
+ *
+ * @return number of children which were running
+ */
+size_t stackDumpWaitChildren();
+
+/**
+ * @brief logs how many times every repeated error happened
+ */
+void stackDumpSummary();
+
 /**
  * @brief print Elem_t as double
  *
@@ -0,0 +1,429 @@
+#include "stack_records.h"
+#include "stack_verification.h"
+#include "stack_logs.h"
+#include "stack_budget.h"
+
+static size_t recordAlign(size_t length)
+{
+    return (length + RECORD_ALIGNMENT - 1) & ~(RECORD_ALIGNMENT - 1);
+}
+
+static RecordFrame *recordStackFrameAt(RecordStack *stack, size_t offset)
+{
+    return (RecordFrame *) (stack->data + offset - sizeof(RecordFrame));
+}
+
+static size_t recordFrameSize(const RecordFrame *frame)
+{
+    return recordAlign(frame->length) + sizeof(RecordFrame);
+}
+
+static void recordStackUpdateHash(RecordStack *stack)
+{
+#if (HashProtection)
+    stack->dataHash = recordStackHashBuffer(stack);
+    stack->hash = recordStackHash(stack);
+#else
+    (void) stack;
+#endif
+}
+
+#if (PoisonProtection)
+static void recordStackPoison(RecordStack *stack, size_t from, size_t to)
+{
+    stackPoisonRange((Elem_t *) (stack->data + from),
+                     (to - from) / sizeof(Elem_t));
+}
+#endif
+
+size_t recordStackCtor__(RecordStack *stack, size_t capacity)
+{
+    assert(stack != nullptr);
+
+    size_t error = STACK_NO_ERRORS;
+
+    capacity = recordAlign(capacity);
+    error = stackBudgetAcquire(stack, STACK_BUDGET_DEFAULT_GROUP, capacity);
+    if (error)
+        return error;
+
+    stack->data = (char *) stackReallocData(nullptr, capacity);
+    if (stack->data == nullptr)
+    {
+        stackBudgetRelease(STACK_BUDGET_DEFAULT_GROUP, capacity);
+        return CANT_ALLOCATE_MEMORY_FOR_STACK;
+    }
+
+#if (CanaryProtection)
+    stack->canary_start = CANARY_START;
+    stack->canary_end = CANARY_END;
+#endif
+
+    stack->size = 0;
+    stack->count = 0;
+    stack->capacity = capacity;
+    stack->alive = true;
+
+#if (PoisonProtection)
+    recordStackPoison(stack, 0, capacity);
+#endif
+    recordStackUpdateHash(stack);
+
+    RECORD_ASSERT_OK(stack, &error)
+
+    return error;
+}
+
+size_t recordStackPush(RecordStack *stack,
+                       const void *record,
+                       size_t length,
+                       RecordTag tag)
+{
+    assert(stack != nullptr);
+    assert(record != nullptr || length == 0);
+
+    size_t error = STACK_NO_ERRORS;
+
+    RECORD_ASSERT_OK(stack, &error)
+    if (error)
+        return error;
+
+    if (length > RECORD_MAX_LENGTH)
+        return CANT_ALLOCATE_MEMORY_FOR_STACK;
+
+    size_t payloadSize = recordAlign(length);
+    size_t newSize = stack->size + payloadSize + sizeof(RecordFrame);
+    if (newSize > stack->capacity)
+    {
+        size_t newCapacity = stack->capacity * 2;
+        if (newCapacity < newSize)
+            newCapacity = newSize;
+
+        error = recordStackResizeMemory(stack, newCapacity);
+        if (error)
+            return error;
+    }
+
+    char *payload = stack->data + stack->size;
+    if (length != 0)
+        memcpy(payload, record, length);
+    memset(payload + length, 0, payloadSize - length);
+
+    RecordFrame *frame = (RecordFrame *) (payload + payloadSize);
+    *frame = {};
+    frame->length = (uint32_t) length;
+    frame->tag = tag;
+
+    stack->size = newSize;
+    stack->count++;
+    recordStackUpdateHash(stack);
+
+    RECORD_ASSERT_OK(stack, &error)
+
+    return error;
+}
+
+size_t recordStackPeek(RecordStack *stack, RecordView *view)
+{
+    assert(stack != nullptr);
+    assert(view != nullptr);
+
+    size_t error = STACK_NO_ERRORS;
+
+    RECORD_ASSERT_OK(stack, &error)
+    if (error)
+        return error;
+
+    if (stack->count == 0)
+    {
+        *view = {};
+        return STACK_IS_EMPTY;
+    }
+
+    RecordFrame *frame = recordStackFrameAt(stack, stack->size);
+    view->data = (char *) frame - recordAlign(frame->length);
+    view->length = frame->length;
+    view->tag = frame->tag;
+
+    return error;
+}
+
+size_t recordStackPop(RecordStack *stack, RecordView *view)
+{
+    assert(stack != nullptr);
+    assert(view != nullptr);
+
+    size_t error = recordStackPeek(stack, view);
+    if (error)
+        return error;
+
+    size_t oldSize = stack->size;
+    stack->size -= recordFrameSize(recordStackFrameAt(stack, oldSize));
+    stack->count--;
+
+#if (PoisonProtection)
+    recordStackPoison(stack, oldSize - sizeof(RecordFrame), oldSize);
+#endif
+    recordStackUpdateHash(stack);
+
+    RECORD_ASSERT_OK(stack, &error)
+
+    return error;
+}
+
+size_t recordStackShrinkToFit(RecordStack *stack)
+{
+    assert(stack != nullptr);
+
+    if (stack->size == 0)
+        return recordStackResizeMemory(stack, RECORD_ALIGNMENT);
+
+    return recordStackResizeMemory(stack, stack->size);
+}
+
+size_t recordStackResizeMemory(RecordStack *stack, size_t newCapacity)
+{
+    assert(stack != nullptr);
+
+    size_t error = STACK_NO_ERRORS;
+
+    newCapacity = recordAlign(newCapacity);
+    if (newCapacity < stack->size)
+        return STACK_SIZE_MORE_THAN_CAPACITY;
+
+    if (newCapacity > stack->capacity)
+        error = stackBudgetAcquire(stack,
+                                   STACK_BUDGET_DEFAULT_GROUP,
+                                   newCapacity - stack->capacity);
+    if (error)
+        return error;
+
+    char *newData = (char *) stackReallocData(stack->data, newCapacity);
+    if (newData == nullptr)
+    {
+        if (newCapacity > stack->capacity)
+            stackBudgetRelease(STACK_BUDGET_DEFAULT_GROUP,
+                               newCapacity - stack->capacity);
+        return CANT_ALLOCATE_MEMORY_FOR_STACK;
+    }
+    if (newCapacity < stack->capacity)
+        stackBudgetRelease(STACK_BUDGET_DEFAULT_GROUP,
+                           stack->capacity - newCapacity);
+
+    stack->data = newData;
+    stack->capacity = newCapacity;
+
+#if (PoisonProtection)
+    recordStackPoison(stack, stack->size, stack->capacity);
+#endif
+    recordStackUpdateHash(stack);
+
+    RECORD_ASSERT_OK(stack, &error)
+
+    return error;
+}
+
+#if (HashProtection)
+size_t recordStackHashBuffer(RecordStack *stack)
+{
+    assert(stack != nullptr);
+
+    return hashData(stack->data, stack->capacity);
+}
+
+size_t recordStackHash(RecordStack *stack)
+{
+    assert(stack != nullptr);
+
+    size_t old_hash = stack->hash;
+    stack->hash = 0;
+    size_t hash = hashData(stack, sizeof(*stack));
+    stack->hash = old_hash;
+    return hash;
+}
+#endif
+
+size_t recordStackVerifier(RecordStack *stack)
+{
+    size_t error = STACK_NO_ERRORS;
+    if (stack == nullptr)
+    {
+        error |= STACK_NULLPTR;
+        return error;
+    }
+
+    if (!stack->alive)
+    {
+        error |= STACK_NOT_ALIVE;
+        return error;
+    }
+
+    if (stack->size > stack->capacity)
+    {
+        error |= STACK_SIZE_MORE_THAN_CAPACITY;
+        return error;
+    }
+
+#if (PoisonProtection)
+    if (stack->data == (const char *) POISON_PTR or stack->data == nullptr)
+#else
+    if (stack->data == nullptr)
+#endif
+    {
+        error |= STACK_POISON_PTR_ERR;
+        return error;
+    }
+
+    size_t offset = stack->size;
+    size_t count = 0;
+    if (offset % RECORD_ALIGNMENT != 0)
+        offset = 0;
+
+    while (offset >= sizeof(RecordFrame))
+    {
+        RecordFrame *frame = recordStackFrameAt(stack, offset);
+#if (FrameCanaryProtection)
+        if (frame->canary != CANARY_FRAME)
+            break;
+#endif
+        size_t frameSize = recordFrameSize(frame);
+        if (frameSize > offset)
+            break;
+
+        offset -= frameSize;
+        count++;
+    }
+
+    if (offset != 0 or count != stack->count)
+        error |= STACK_RECORD_FRAME_CORRUPTED;
+
+# if (HashProtection)
+    if (stack->dataHash != recordStackHashBuffer(stack))
+    {
+        error |= STACK_DATA_INCORRECT_HASH;
+    }
+
+    if (stack->hash != recordStackHash(stack))
+    {
+        error |= STACK_INCORRECT_HASH;
+    }
+# endif
+
+# if (CanaryProtection)
+    stackVerifyStructCanaries(stack->canary_start, stack->canary_end, &error);
+    stackVerifyDataCanaries(stack->data, stack->capacity, &error);
+# endif
+
+    return error;
+}
+
+void recordStackDump(RecordStack *stack, StackInfo *info, size_t error)
+{
+    if (!stackDumpThrottle(stack, info, error))
+        return;
+
+    if (STACK_LOG_FILE == nullptr)
+        STACK_LOG_FILE = stderr;
+
+    logStack(STACK_LOG_FILE, "-----START LOGGING RECORD STACK-----\n");
+    if (stack == nullptr)
+    {
+        logStack(STACK_LOG_FILE,
+                 "Can't log stack with pointer == nullptr\n");
+        logStack(STACK_LOG_FILE, "-----END LOGGING RECORD STACK-----\n");
+        return;
+    }
+
+    const StackInfo *stackInfo = stackInfoGet(stack->infoId);
+    logStack(STACK_LOG_FILE, "Error code %zu.\n", error);
+    if (info != nullptr)
+        logStack(STACK_LOG_FILE,
+                 "Error in stack '%s' in function '%s' at %s (%d)\n",
+                 info->name,
+                 info->initFunction,
+                 info->initFile,
+                 info->initLine);
+    logStack(STACK_LOG_FILE,
+             "Stack [%p] '%s' was initialized at %s at %s (%d)\n",
+             stack,
+             stackInfo->name,
+             stackInfo->initFunction,
+             stackInfo->initFile,
+             stackInfo->initLine);
+
+    if (error & (STACK_NOT_ALIVE | STACK_SIZE_MORE_THAN_CAPACITY
+        | STACK_POISON_PTR_ERR))
+    {
+        processError(error);
+        logStack(STACK_LOG_FILE, "-----END LOGGING RECORD STACK-----\n");
+        return;
+    }
+
+    logStack(STACK_LOG_FILE, "{\n"
+                             "    Size = %zu \n"
+                             "    Capacity = %zu \n"
+                             "    Count = %zu \n"
+                             "    Data [%p] \n",
+             stack->size,
+             stack->capacity,
+             stack->count,
+             stack->data);
+
+    size_t offset = stack->size;
+    for (size_t i = stack->count; i > 0 and offset >= sizeof(RecordFrame);
+         i--)
+    {
+        RecordFrame *frame = recordStackFrameAt(stack, offset);
+        size_t frameSize = recordFrameSize(frame);
+        if (frameSize > offset)
+            break;
+
+        offset -= frameSize;
+        logStack(STACK_LOG_FILE,
+                 "    [%zu] tag = %u, length = %u, offset = %zu\n",
+                 i - 1,
+                 frame->tag,
+                 frame->length,
+                 offset);
+    }
+    logStack(STACK_LOG_FILE, "}\n");
+
+    processError(error);
+    logStack(STACK_LOG_FILE, "-----END LOGGING RECORD STACK-----\n");
+}
+
+size_t recordStackDtor(RecordStack *stack)
+{
+    assert(stack != nullptr);
+
+    size_t error = STACK_NO_ERRORS;
+
+    RECORD_ASSERT_OK(stack, &error)
+    if (error)
+        return error;
+
+    stackFreeData(stack->data);
+    stackBudgetRelease(STACK_BUDGET_DEFAULT_GROUP, stack->capacity);
+
+#if (PoisonProtection)
+    stack->data = (char *) POISON_PTR;
+#else
+    stack->data = nullptr;
+#endif
+
+    stack->size = (size_t) POISON_INT_VALUE;
+    stack->capacity = (size_t) POISON_INT_VALUE;
+    stack->count = (size_t) POISON_INT_VALUE;
+    stack->alive = false;
+
+#if (CanaryProtection)
+    stack->canary_start = CANARY_POISONED;
+    stack->canary_end = CANARY_POISONED;
+#endif
+
+#if (HashProtection)
+    stack->hash = (size_t) POISON_INT_VALUE;
+    stack->dataHash = (size_t) POISON_INT_VALUE;
+#endif
+    return error;
+}
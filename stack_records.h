@@ -0,0 +1,200 @@
+#ifndef STACK_RECORDS_H
+#define STACK_RECORDS_H
+
+#include "stack.h"
+
+typedef uint32_t RecordTag;
+
+const size_t RECORD_ALIGNMENT = sizeof(Canary);
+const size_t RECORD_MAX_LENGTH = STACK_MAX_CAPACITY;
+
+#if (FrameCanaryProtection)
+const uint64_t CANARY_FRAME = 0xFEEDFACE;
+#endif
+
+/**
+ * @brief header of record, stored right after aligned payload
+ */
+struct RecordFrame
+{
+    uint32_t length = 0;
+    RecordTag tag = 0;
+#if (FrameCanaryProtection)
+    Canary canary = CANARY_FRAME;
+#endif
+};
+
+/**
+ * @brief in-place view of record, valid until next push or resize
+ */
+struct RecordView
+{
+    const void *data = nullptr;
+    size_t length = 0;
+    RecordTag tag = 0;
+};
+
+struct RecordStack
+{
+#if (CanaryProtection)
+    Canary canary_start = CANARY_START;
+#endif
+
+#if (PoisonProtection)
+    char *data = (char *) POISON_PTR;
+#else
+    char *data = nullptr;
+#endif
+
+    size_t capacity = 0;
+    size_t size = 0;
+    size_t count = 0;
+
+    StackInfoId infoId = STACK_UNKNOWN_INFO_ID;
+    bool alive = false;
+#if (HashProtection)
+    size_t dataHash = 0;
+    size_t hash = 0;
+#endif
+
+#if (CanaryProtection)
+    Canary canary_end = CANARY_END;
+#endif
+};
+
+/**
+ * @brief constructor for record stack
+ *
+ * @param stack stack for constructing
+ * @param capacity initial capacity in bytes
+ * @return error code
+ */
+size_t recordStackCtor__(RecordStack *stack, size_t capacity);
+
+/**
+ * @brief macro constructor for record stack
+ *
+ * @param stack stack for constructing
+ * @param capacity initial capacity in bytes
+ * @param error error code
+ * @return void
+ */
+#define recordStackCtor(stack, capacity, error)                        \
+{                                                                      \
+    static const StackInfoId stackInfoId_ = stackInfoRegister(         \
+        {__LINE__, __FILE__, __PRETTY_FUNCTION__, #stack});            \
+    (stack)->infoId = stackInfoId_;                                    \
+    *(error) = recordStackCtor__((stack), (capacity));                 \
+}
+
+/**
+ * @brief reserves frame and copies record to it
+ *
+ * @param stack stack for pushing
+ * @param record bytes of record
+ * @param length length of record in bytes
+ * @param tag tag of record
+ * @return error code
+ */
+size_t recordStackPush(RecordStack *stack,
+                       const void *record,
+                       size_t length,
+                       RecordTag tag);
+
+/**
+ * @brief gets view of last record without removing it
+ *
+ * @param stack stack to peek
+ * @param view view of record
+ * @return error code
+ */
+size_t recordStackPeek(RecordStack *stack, RecordView *view);
+
+/**
+ * @brief removes last record, memory is not released so view stays valid
+ * until next push or resize
+ *
+ * @param stack stack for extracting
+ * @param view view of extracted record
+ * @return error code
+ */
+size_t recordStackPop(RecordStack *stack, RecordView *view);
+
+/**
+ * @brief shrink record stack to size
+ *
+ * @param stack stack to shrink
+ * @return error code
+ */
+size_t recordStackShrinkToFit(RecordStack *stack);
+
+/**
+ * @brief resizes record stack to certain capacity
+ *
+ * @param stack stack for resizing
+ * @param newCapacity new capacity in bytes
+ * @return error code
+ */
+size_t recordStackResizeMemory(RecordStack *stack, size_t newCapacity);
+
+#if (HashProtection)
+/**
+ * @brief hashes record stack data
+ *
+ * @param stack stack to hash its data
+ * @return hash of stack data
+ */
+size_t recordStackHashBuffer(RecordStack *stack);
+
+/**
+ * @brief hashes record stack
+ *
+ * @param stack stack to hash
+ * @return hash of stack
+ */
+size_t recordStackHash(RecordStack *stack);
+#endif
+
+/**
+ * @brief checks if record stack is correct
+ *
+ * @param stack stack for checking
+ * @return error code
+ */
+size_t recordStackVerifier(RecordStack *stack);
+
+/**
+ * @brief generates dump of record stack
+ *
+ * @param stack stack for dumping
+ * @param info struct with info about callsite
+ * @param error error code
+ */
+void recordStackDump(RecordStack *stack, StackInfo *info, size_t error);
+
+/**
+ * @brief destructor for record stack
+ *
+ * @param stack stack for destructing
+ * @return error code
+ */
+size_t recordStackDtor(RecordStack *stack);
+
+/**
+ * @brief macro for checking if record stack is correct
+ *
+ * @param stack stack for checking
+ * @param error error code
+ */
+#define RECORD_ASSERT_OK(stack, error)                                 \
+{                                                                      \
+    *(error) = recordStackVerifier((stack));                           \
+    if (STACK_UNLIKELY(*(error)))                                      \
+    {                                                                  \
+        StackInfo info = {__LINE__, __FILE__, __PRETTY_FUNCTION__,     \
+                          #stack};                                     \
+        recordStackDump((stack), &(info), *(error));                   \
+    }                                                                  \
+}
+
+#endif
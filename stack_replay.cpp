@@ -0,0 +1,266 @@
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+
+#include "stack.h"
+#include "stack_logs.h"
+#include "stack_aggregate.h"
+#include "stack_trace.h"
+
+typedef std::chrono::steady_clock ReplayClock;
+
+/**
+ * @brief set of functions to replay trace against
+ */
+struct ReplayBackend
+{
+    const char *name;
+    void *(*ctor)(size_t numOfElements, size_t *error);
+    size_t (*push)(void *stack, Elem_t value);
+    size_t (*pop)(void *stack, Elem_t *value);
+    size_t (*dtor)(void *stack);
+};
+
+static void *replayStackCtor(size_t numOfElements, size_t *error)
+{
+    Stack *stack = (Stack *) calloc(1, sizeof(Stack));
+    if (stack == nullptr)
+    {
+        *error = CANT_ALLOCATE_MEMORY;
+        return nullptr;
+    }
+
+    *stack = {};
+    stackCtor(stack, numOfElements, error)
+    return stack;
+}
+
+static size_t replayStackPush(void *stack, Elem_t value)
+{
+    return stackPush((Stack *) stack, value);
+}
+
+static size_t replayStackPop(void *stack, Elem_t *value)
+{
+    return stackPop((Stack *) stack, value);
+}
+
+static size_t replayStackDtor(void *stack)
+{
+    size_t error = stackDtor((Stack *) stack);
+    free(stack);
+    return error;
+}
+
+static void *replayAggregateCtor(size_t numOfElements, size_t *error)
+{
+    AggregateStack *aggregate =
+        (AggregateStack *) calloc(1, sizeof(AggregateStack));
+    if (aggregate == nullptr)
+    {
+        *error = CANT_ALLOCATE_MEMORY;
+        return nullptr;
+    }
+
+    *aggregate = {};
+    aggregateStackCtor(aggregate, numOfElements, error)
+    return aggregate;
+}
+
+static size_t replayAggregatePush(void *stack, Elem_t value)
+{
+    return aggregateStackPush((AggregateStack *) stack, value);
+}
+
+static size_t replayAggregatePop(void *stack, Elem_t *value)
+{
+    return aggregateStackPop((AggregateStack *) stack, value);
+}
+
+static size_t replayAggregateDtor(void *stack)
+{
+    size_t error = aggregateStackDtor((AggregateStack *) stack);
+    free(stack);
+    return error;
+}
+
+static const ReplayBackend REPLAY_BACKENDS[] = {
+    {"stack", replayStackCtor, replayStackPush, replayStackPop,
+     replayStackDtor},
+    {"aggregate", replayAggregateCtor, replayAggregatePush,
+     replayAggregatePop, replayAggregateDtor},
+};
+
+static const char *const REPLAY_OP_NAMES[TRACE_OPS_COUNT] = {
+    "ctor", "push", "pop", "resize", "dtor"
+};
+
+static uint64_t replayPercentile(const std::vector<uint64_t> &sorted,
+                                 double percentile)
+{
+    size_t index = (size_t) (percentile * (double) (sorted.size() - 1));
+    return sorted[index];
+}
+
+static void replayReport(std::vector<uint64_t> *latencies,
+                         size_t resizes,
+                         size_t errors,
+                         double seconds)
+{
+    size_t calls = 0;
+    for (size_t op = 0; op < TRACE_OPS_COUNT; op++)
+        calls += latencies[op].size();
+
+    printf("%zu calls in %.3f s, %.0f calls/s, %zu resizes in trace, "
+           "%zu errors\n",
+           calls,
+           seconds,
+           (double) calls / seconds,
+           resizes,
+           errors);
+    printf("%-8s %10s %8s %8s %8s %8s %10s (ns)\n",
+           "op", "calls", "p50", "p90", "p99", "p99.9", "max");
+
+    for (size_t op = 0; op < TRACE_OPS_COUNT; op++)
+    {
+        std::vector<uint64_t> &sorted = latencies[op];
+        if (sorted.empty())
+            continue;
+
+        std::sort(sorted.begin(), sorted.end());
+        printf("%-8s %10zu %8llu %8llu %8llu %8llu %10llu\n",
+               REPLAY_OP_NAMES[op],
+               sorted.size(),
+               (unsigned long long) replayPercentile(sorted, 0.5),
+               (unsigned long long) replayPercentile(sorted, 0.9),
+               (unsigned long long) replayPercentile(sorted, 0.99),
+               (unsigned long long) replayPercentile(sorted, 0.999),
+               (unsigned long long) sorted.back());
+    }
+}
+
+/**
+ * @brief replays calls of trace in order of their timestamps
+ *
+ * Stacks are matched by address which they had in traced program.
+ * Resizes are only counted, they are replayed by pushes and pops.
+ */
+static size_t replay(const ReplayBackend *backend,
+                     const StackTraceRecord *records,
+                     size_t count)
+{
+    std::unordered_map<uint64_t, void *> stacks;
+    std::vector<uint64_t> latencies[TRACE_OPS_COUNT];
+    size_t resizes = 0;
+    size_t errors = 0;
+
+    ReplayClock::time_point start = ReplayClock::now();
+    for (size_t i = 0; i < count; i++)
+    {
+        const StackTraceRecord *record = &records[i];
+        if (record->op >= TRACE_OPS_COUNT)
+            return STACK_TRACE_INCORRECT;
+
+        if (record->op == TRACE_RESIZE)
+        {
+            resizes++;
+            continue;
+        }
+
+        size_t error = STACK_NO_ERRORS;
+        Elem_t value = 0;
+        void *&stack = stacks[record->stack];
+
+        ReplayClock::time_point callStart = ReplayClock::now();
+        if (stack == nullptr)
+        {
+            size_t numOfElements = record->op == TRACE_CTOR
+                ? (size_t) record->value : 0;
+            stack = backend->ctor(numOfElements, &error);
+            if (stack == nullptr)
+                return error;
+        }
+
+        switch ((StackTraceOp) record->op)
+        {
+            case TRACE_PUSH:
+                error |= backend->push(stack, record->value);
+                break;
+            case TRACE_POP:
+                error |= backend->pop(stack, &value);
+                break;
+            case TRACE_DTOR:
+                error |= backend->dtor(stack);
+                stacks.erase(record->stack);
+                break;
+            case TRACE_CTOR:
+            case TRACE_RESIZE:
+            case TRACE_OPS_COUNT:
+            default:
+                break;
+        }
+        latencies[record->op].push_back(
+            (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+                ReplayClock::now() - callStart).count());
+
+        if (error)
+            errors++;
+    }
+    double seconds =
+        std::chrono::duration<double>(ReplayClock::now() - start).count();
+
+    for (auto &stack: stacks)
+        backend->dtor(stack.second);
+
+    replayReport(latencies, resizes, errors, seconds);
+    return STACK_NO_ERRORS;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2 or argc > 3)
+    {
+        printf("Usage: %s trace [stack|aggregate]\n", argv[0]);
+        return 1;
+    }
+
+    const ReplayBackend *backend = &REPLAY_BACKENDS[0];
+    if (argc == 3)
+    {
+        backend = nullptr;
+        for (const ReplayBackend &candidate: REPLAY_BACKENDS)
+            if (strcmp(candidate.name, argv[2]) == 0)
+                backend = &candidate;
+
+        if (backend == nullptr)
+        {
+            printf("Unknown backend '%s'\n", argv[2]);
+            return 1;
+        }
+    }
+
+    StackTraceRecord *records = nullptr;
+    size_t count = 0;
+    size_t error = stackTraceRead(argv[1], &records, &count);
+    if (!error)
+    {
+        printf("Replaying %zu records of '%s' on %s backend "
+               "(hash %d, canary %d, poison %d)\n",
+               count,
+               argv[1],
+               backend->name,
+               HashProtection,
+               CanaryProtection,
+               PoisonProtection);
+        error = replay(backend, records, count);
+    }
+    free(records);
+
+    if (error)
+    {
+        processError(error);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,317 @@
+#include "stack_ring.h"
+#include "stack_verification.h"
+#include "stack_logs.h"
+#include "stack_budget.h"
+#include "stack_simd.h"
+
+#include <algorithm>
+
+/**
+ * @brief gets index in buffer of element
+ *
+ * @param stack ring stack
+ * @param position position of element counted from oldest one
+ * @return index in data
+ */
+static size_t ringStackIndex(const RingStack *stack, size_t position)
+{
+    return ((size_t) stack->top + stack->capacity - stack->size + position)
+        % stack->capacity;
+}
+
+#if (HashProtection)
+static size_t ringStackHash(const RingStack *stack)
+{
+    RingStack copy = {};
+    memcpy((void *) &copy, (const void *) stack, sizeof(RingStack));
+    copy.hash = 0;
+    return hashData(&copy, sizeof(copy));
+}
+
+static void ringStackUpdateHash(RingStack *stack)
+{
+    stack->dataHash = hashData(stack->data,
+                               (size_t) stack->capacity * sizeof(Elem_t));
+    stack->hash = ringStackHash(stack);
+}
+#endif
+
+size_t ringStackCtor__(RingStack *stack, size_t capacity)
+{
+    assert(stack != nullptr);
+
+    size_t error = STACK_NO_ERRORS;
+
+    if (capacity == 0 or capacity > STACK_MAX_CAPACITY)
+        return CANT_ALLOCATE_MEMORY_FOR_STACK;
+
+    error = stackBudgetAcquire(stack,
+                               STACK_BUDGET_DEFAULT_GROUP,
+                               capacity * sizeof(Elem_t));
+    if (error)
+        return error;
+
+    stack->data = (Elem_t *) stackReallocData(nullptr,
+                                              capacity * sizeof(Elem_t));
+    if (stack->data == nullptr)
+    {
+        stackBudgetRelease(STACK_BUDGET_DEFAULT_GROUP,
+                           capacity * sizeof(Elem_t));
+        return CANT_ALLOCATE_MEMORY_FOR_STACK;
+    }
+
+#if (CanaryProtection)
+    stack->canary_start = CANARY_START;
+    stack->canary_end = CANARY_END;
+#endif
+
+#if (PoisonProtection)
+    stackPoisonRange(stack->data, capacity);
+#endif
+
+    stack->capacity = (StackSize_t) capacity;
+    stack->size = 0;
+    stack->top = 0;
+    stack->discarded = 0;
+    stack->alive = true;
+
+#if (HashProtection)
+    ringStackUpdateHash(stack);
+#endif
+
+    RING_ASSERT_OK(stack, &error)
+
+    return error;
+}
+
+size_t ringStackPush(RingStack *stack, Elem_t value)
+{
+    assert(stack != nullptr);
+
+    size_t error = STACK_NO_ERRORS;
+
+    RING_ASSERT_OK(stack, &error)
+    if (error)
+        return error;
+
+    stack->data[stack->top] = value;
+    stack->top = (StackSize_t) ((stack->top + 1) % stack->capacity);
+    if (stack->size == stack->capacity)
+        stack->discarded++;
+    else
+        stack->size++;
+
+#if (HashProtection)
+    ringStackUpdateHash(stack);
+#endif
+
+    RING_ASSERT_OK(stack, &error)
+
+    return error;
+}
+
+size_t ringStackPop(RingStack *stack, Elem_t *value)
+{
+    assert(stack != nullptr);
+    assert(value != nullptr);
+
+    size_t error = STACK_NO_ERRORS;
+
+    RING_ASSERT_OK(stack, &error)
+    if (error)
+        return error;
+
+    if (stack->size == 0)
+    {
+        *value = 0;
+        return STACK_IS_EMPTY;
+    }
+
+    stack->top = (StackSize_t) ((stack->top + stack->capacity - 1)
+        % stack->capacity);
+    stack->size--;
+    *value = stack->data[stack->top];
+#if (PoisonProtection)
+    stack->data[stack->top] = POISON_VALUE;
+#endif
+
+#if (HashProtection)
+    ringStackUpdateHash(stack);
+#endif
+
+    RING_ASSERT_OK(stack, &error)
+
+    return error;
+}
+
+size_t ringStackVerifier(RingStack *stack)
+{
+    size_t error = STACK_NO_ERRORS;
+    if (stack == nullptr)
+    {
+        error |= STACK_NULLPTR;
+        return error;
+    }
+
+    if (!stack->alive)
+    {
+        error |= STACK_NOT_ALIVE;
+        return error;
+    }
+
+    if (stack->size > stack->capacity or stack->top >= stack->capacity)
+    {
+        error |= STACK_SIZE_MORE_THAN_CAPACITY;
+        return error;
+    }
+
+#if (PoisonProtection)
+    if (stack->data == POISON_PTR or stack->data == nullptr)
+#else
+    if (stack->data == nullptr)
+#endif
+    {
+        error |= STACK_POISON_PTR_ERR;
+        return error;
+    }
+
+#if (PoisonProtection)
+    size_t oldest = ringStackIndex(stack, 0);
+    size_t first = std::min((size_t) stack->size,
+                            (size_t) stack->capacity - oldest);
+    if (stackFindPoison(stack->data + oldest, first) != first
+        or stackFindPoison(stack->data, stack->size - first)
+            != stack->size - first)
+        error |= STACK_POISONED_DATA;
+#endif
+
+#if (HashProtection)
+    if (stack->dataHash != hashData(stack->data,
+                                    (size_t) stack->capacity
+                                        * sizeof(Elem_t)))
+        error |= STACK_DATA_INCORRECT_HASH;
+
+    if (stack->hash != ringStackHash(stack))
+        error |= STACK_INCORRECT_HASH;
+#endif
+
+#if (CanaryProtection)
+    stackVerifyStructCanaries(stack->canary_start, stack->canary_end, &error);
+    stackVerifyDataCanaries(stack->data,
+                            sizeof(Elem_t) * (size_t) stack->capacity,
+                            &error);
+#endif
+
+    return error;
+}
+
+STACK_COLD
+void ringStackDump(RingStack *stack, StackInfo *info, size_t error)
+{
+    if (!stackDumpThrottle(stack, info, error))
+        return;
+
+    if (STACK_LOG_FILE == nullptr)
+        STACK_LOG_FILE = stderr;
+
+    logStack(STACK_LOG_FILE, "-----START LOGGING RING STACK-----\n");
+    if (stack == nullptr)
+    {
+        logStack(STACK_LOG_FILE,
+                 "Can't log stack with pointer == nullptr\n");
+        logStack(STACK_LOG_FILE, "-----END LOGGING RING STACK-----\n");
+        return;
+    }
+
+    const StackInfo *stackInfo = stackInfoGet(stack->infoId);
+    logStack(STACK_LOG_FILE, "Error code %zu.\n", error);
+    if (info != nullptr)
+        logStack(STACK_LOG_FILE,
+                 "Error in stack '%s' in function '%s' at %s (%d)\n",
+                 info->name,
+                 info->initFunction,
+                 info->initFile,
+                 info->initLine);
+    logStack(STACK_LOG_FILE,
+             "Stack [%p] '%s' was initialized at %s at %s (%d)\n",
+             stack,
+             stackInfo->name,
+             stackInfo->initFunction,
+             stackInfo->initFile,
+             stackInfo->initLine);
+
+    if (error & (STACK_NOT_ALIVE | STACK_SIZE_MORE_THAN_CAPACITY
+        | STACK_POISON_PTR_ERR))
+    {
+        processError(error);
+        logStack(STACK_LOG_FILE, "-----END LOGGING RING STACK-----\n");
+        return;
+    }
+
+    logStack(STACK_LOG_FILE, "{\n"
+                             "    Size = %zu \n"
+                             "    Capacity = %zu \n"
+                             "    Top = %zu \n"
+                             "    Discarded = %zu \n"
+                             "    Data [%p] \n",
+             (size_t) stack->size,
+             (size_t) stack->capacity,
+             (size_t) stack->top,
+             stack->discarded,
+             stack->data);
+
+    for (size_t i = 0; i < stack->size; i++)
+    {
+        size_t index = ringStackIndex(stack, i);
+        logStack(STACK_LOG_FILE, "    * [%zu] = ", index);
+        printElem_t(STACK_LOG_FILE, stack->data[index]);
+#if (PoisonProtection)
+        logStack(STACK_LOG_FILE,
+                 " %s\n",
+                 isPoison(stack->data[index]) ? "(Poisoned)" : "");
+#else
+        logStack(STACK_LOG_FILE, "\n");
+#endif
+    }
+    logStack(STACK_LOG_FILE, "}\n");
+
+    processError(error);
+    logStack(STACK_LOG_FILE, "-----END LOGGING RING STACK-----\n");
+}
+
+size_t ringStackDtor(RingStack *stack)
+{
+    assert(stack != nullptr);
+
+    size_t error = STACK_NO_ERRORS;
+
+    RING_ASSERT_OK(stack, &error)
+    if (error)
+        return error;
+
+    stackFreeData(stack->data);
+    stackBudgetRelease(STACK_BUDGET_DEFAULT_GROUP,
+                       (size_t) stack->capacity * sizeof(Elem_t));
+
+#if (PoisonProtection)
+    stack->data = (Elem_t *) POISON_PTR;
+#else
+    stack->data = nullptr;
+#endif
+
+    stack->size = (StackSize_t) POISON_INT_VALUE;
+    stack->capacity = (StackSize_t) POISON_INT_VALUE;
+    stack->top = (StackSize_t) POISON_INT_VALUE;
+    stack->alive = false;
+
+#if (CanaryProtection)
+    stack->canary_start = CANARY_POISONED;
+    stack->canary_end = CANARY_POISONED;
+#endif
+
+#if (HashProtection)
+    stack->hash = (size_t) POISON_INT_VALUE;
+    stack->dataHash = (size_t) POISON_INT_VALUE;
+#endif
+    return error;
+}
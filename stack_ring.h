@@ -0,0 +1,125 @@
+#ifndef STACK_RING_H
+#define STACK_RING_H
+
+#include "stack.h"
+
+/**
+ * @brief stack of at most capacity elements over ring buffer, push to full
+ * stack overwrites oldest element
+ *
+ * Elements are at indices top - size ... top - 1 modulo capacity, newest
+ * one is at top - 1. Buffer is allocated once in constructor and has data
+ * canaries like buffer of Stack, free cells are poisoned.
+ */
+struct RingStack
+{
+#if (CanaryProtection)
+    Canary canary_start = CANARY_START;
+#endif
+
+    Elem_t *data = nullptr;
+    StackSize_t capacity = 0;
+    StackSize_t size = 0;
+    StackSize_t top = 0;
+
+    StackInfoId infoId = STACK_UNKNOWN_INFO_ID;
+    bool alive = false;
+    /// number of elements overwritten by pushes to full stack
+    size_t discarded = 0;
+
+#if (HashProtection)
+    size_t dataHash = 0;
+    size_t hash = 0;
+#endif
+
+#if (CanaryProtection)
+    Canary canary_end = CANARY_END;
+#endif
+};
+
+/**
+ * @brief constructor for ring stack
+ *
+ * @param stack stack for constructing
+ * @param capacity max number of elements, must not be zero
+ * @return error code
+ */
+size_t ringStackCtor__(RingStack *stack, size_t capacity);
+
+/**
+ * @brief macro constructor for ring stack
+ *
+ * @param ring stack for constructing
+ * @param capacity max number of elements, must not be zero
+ * @param error error code
+ * @return void
+ */
+#define ringStackCtor(ring, capacity, error)                           \
+{                                                                      \
+    static const StackInfoId stackInfoId_ = stackInfoRegister(         \
+        {__LINE__, __FILE__, __PRETTY_FUNCTION__, #ring});             \
+    (ring)->infoId = stackInfoId_;                                     \
+    *(error) = ringStackCtor__((ring), (capacity));                    \
+}
+
+/**
+ * @brief pushes element, overwrites oldest element if stack is full
+ *
+ * @param stack stack for pushing
+ * @param value pushing value
+ * @return error code
+ */
+size_t ringStackPush(RingStack *stack, Elem_t value);
+
+/**
+ * @brief extracts newest element
+ *
+ * @param stack stack for extracting
+ * @param value variable for storing extracted element
+ * @return error code
+ */
+size_t ringStackPop(RingStack *stack, Elem_t *value);
+
+/**
+ * @brief checks if ring stack is correct
+ *
+ * @param stack stack for checking
+ * @return error code
+ */
+size_t ringStackVerifier(RingStack *stack);
+
+/**
+ * @brief generates dump of ring stack, elements are printed from oldest
+ *
+ * @param stack stack for dumping
+ * @param info struct with info about callsite
+ * @param error error code
+ */
+void ringStackDump(RingStack *stack, StackInfo *info, size_t error);
+
+/**
+ * @brief destructor for ring stack
+ *
+ * @param stack stack for destructing
+ * @return error code
+ */
+size_t ringStackDtor(RingStack *stack);
+
+/**
+ * @brief macro for checking if ring stack is correct
+ *
+ * @param ring stack for checking
+ * @param error error code
+ */
+#define RING_ASSERT_OK(ring, error)                                    \
+{                                                                      \
+    *(error) = ringStackVerifier((ring));                              \
+    if (STACK_UNLIKELY(*(error)))                                      \
+    {                                                                  \
+        StackInfo info = {__LINE__, __FILE__, __PRETTY_FUNCTION__,     \
+                          #ring};                                      \
+        ringStackDump((ring), &(info), *(error));                      \
+    }                                                                  \
+}
+
+#endif
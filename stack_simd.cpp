@@ -0,0 +1,615 @@
+#include "stack_simd.h"
+
+#include <atomic>
+
+#if defined(__x86_64__) or defined(__i386__)
+#define STACK_SIMD_X86 1
+#include <immintrin.h>
+static_assert(sizeof(Elem_t) == sizeof(int32_t)
+                  and sizeof(StackSize_t) == sizeof(int32_t),
+              "SIMD kernels work on 32-bit elements and sizes");
+#else
+#define STACK_SIMD_X86 0
+#endif
+
+#if (PoisonProtection)
+typedef size_t (*StackFindPoisonKernel)(const Elem_t *data, size_t count);
+typedef void (*StackFillPoisonKernel)(Elem_t *data, size_t count);
+
+static size_t stackFindPoisonScalar(const Elem_t *data, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (data[i] == POISON_VALUE)
+            return i;
+    }
+    return count;
+}
+
+static void stackFillPoisonScalar(Elem_t *data, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        data[i] = POISON_VALUE;
+}
+
+#if (STACK_SIMD_X86)
+__attribute__((target("sse2")))
+static size_t stackFindPoisonSse2(const Elem_t *data, size_t count)
+{
+    const __m128i poison = _mm_set1_epi32(POISON_VALUE);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i values = _mm_loadu_si128((const __m128i *) (data + i));
+        int mask = _mm_movemask_ps(
+            _mm_castsi128_ps(_mm_cmpeq_epi32(values, poison)));
+        if (mask)
+            return i + (size_t) __builtin_ctz((unsigned) mask);
+    }
+    return i + stackFindPoisonScalar(data + i, count - i);
+}
+
+__attribute__((target("sse2")))
+static void stackFillPoisonSse2(Elem_t *data, size_t count)
+{
+    const __m128i poison = _mm_set1_epi32(POISON_VALUE);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+        _mm_storeu_si128((__m128i *) (data + i), poison);
+    stackFillPoisonScalar(data + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static size_t stackFindPoisonAvx2(const Elem_t *data, size_t count)
+{
+    const __m256i poison = _mm256_set1_epi32(POISON_VALUE);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i values = _mm256_loadu_si256((const __m256i *) (data + i));
+        int mask = _mm256_movemask_ps(
+            _mm256_castsi256_ps(_mm256_cmpeq_epi32(values, poison)));
+        if (mask)
+            return i + (size_t) __builtin_ctz((unsigned) mask);
+    }
+    return i + stackFindPoisonScalar(data + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void stackFillPoisonAvx2(Elem_t *data, size_t count)
+{
+    const __m256i poison = _mm256_set1_epi32(POISON_VALUE);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+        _mm256_storeu_si256((__m256i *) (data + i), poison);
+    stackFillPoisonScalar(data + i, count - i);
+}
+
+__attribute__((target("avx512f")))
+static size_t stackFindPoisonAvx512(const Elem_t *data, size_t count)
+{
+    const __m512i poison = _mm512_set1_epi32(POISON_VALUE);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m512i values = _mm512_loadu_si512((const void *) (data + i));
+        __mmask16 mask = _mm512_cmpeq_epi32_mask(values, poison);
+        if (mask)
+            return i + (size_t) __builtin_ctz((unsigned) mask);
+    }
+    return i + stackFindPoisonScalar(data + i, count - i);
+}
+
+__attribute__((target("avx512f")))
+static void stackFillPoisonAvx512(Elem_t *data, size_t count)
+{
+    const __m512i poison = _mm512_set1_epi32(POISON_VALUE);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+        _mm512_storeu_si512((void *) (data + i), poison);
+    stackFillPoisonScalar(data + i, count - i);
+}
+
+static const StackFindPoisonKernel STACK_FIND_POISON[STACK_SIMD_LEVELS] = {
+    stackFindPoisonScalar,
+    stackFindPoisonSse2,
+    stackFindPoisonAvx2,
+    stackFindPoisonAvx512,
+};
+
+static const StackFillPoisonKernel STACK_FILL_POISON[STACK_SIMD_LEVELS] = {
+    stackFillPoisonScalar,
+    stackFillPoisonSse2,
+    stackFillPoisonAvx2,
+    stackFillPoisonAvx512,
+};
+#else
+static const StackFindPoisonKernel STACK_FIND_POISON[STACK_SIMD_LEVELS] = {
+    stackFindPoisonScalar,
+    stackFindPoisonScalar,
+    stackFindPoisonScalar,
+    stackFindPoisonScalar,
+};
+
+static const StackFillPoisonKernel STACK_FILL_POISON[STACK_SIMD_LEVELS] = {
+    stackFillPoisonScalar,
+    stackFillPoisonScalar,
+    stackFillPoisonScalar,
+    stackFillPoisonScalar,
+};
+#endif
+#endif
+
+typedef size_t (*StackScatterPushKernel)(Elem_t *data,
+                                         StackSize_t *sizes,
+                                         size_t count,
+                                         size_t capacity,
+                                         const Elem_t *values,
+                                         const uint8_t *mask,
+                                         uint8_t *failed);
+typedef size_t (*StackGatherPopKernel)(Elem_t *data,
+                                       StackSize_t *sizes,
+                                       size_t count,
+                                       size_t capacity,
+                                       Elem_t *values,
+                                       const uint8_t *mask,
+                                       uint8_t *failed);
+
+static size_t stackScatterPushRange(Elem_t *data,
+                                    StackSize_t *sizes,
+                                    size_t capacity,
+                                    const Elem_t *values,
+                                    const uint8_t *mask,
+                                    uint8_t *failed,
+                                    size_t begin,
+                                    size_t end)
+{
+    size_t full = 0;
+    for (size_t i = begin; i < end; i++)
+    {
+        if (mask != nullptr and !mask[i])
+            continue;
+
+        size_t size = sizes[i];
+        if (size == capacity)
+        {
+            if (failed != nullptr)
+                failed[i] = 1;
+            full++;
+            continue;
+        }
+
+        data[i * capacity + size] = values[i];
+        sizes[i] = (StackSize_t) (size + 1);
+    }
+    return full;
+}
+
+static size_t stackGatherPopRange(Elem_t *data,
+                                  StackSize_t *sizes,
+                                  size_t capacity,
+                                  Elem_t *values,
+                                  const uint8_t *mask,
+                                  uint8_t *failed,
+                                  size_t begin,
+                                  size_t end)
+{
+    size_t empty = 0;
+    for (size_t i = begin; i < end; i++)
+    {
+        if (mask != nullptr and !mask[i])
+            continue;
+
+        size_t size = sizes[i];
+        if (size == 0)
+        {
+            values[i] = 0;
+            if (failed != nullptr)
+                failed[i] = 1;
+            empty++;
+            continue;
+        }
+
+        size--;
+        values[i] = data[i * capacity + size];
+#if (PoisonProtection)
+        data[i * capacity + size] = POISON_VALUE;
+#endif
+        sizes[i] = (StackSize_t) size;
+    }
+    return empty;
+}
+
+static size_t stackScatterPushScalar(Elem_t *data,
+                                     StackSize_t *sizes,
+                                     size_t count,
+                                     size_t capacity,
+                                     const Elem_t *values,
+                                     const uint8_t *mask,
+                                     uint8_t *failed)
+{
+    return stackScatterPushRange(data, sizes, capacity, values, mask, failed,
+                                 0, count);
+}
+
+static size_t stackGatherPopScalar(Elem_t *data,
+                                   StackSize_t *sizes,
+                                   size_t count,
+                                   size_t capacity,
+                                   Elem_t *values,
+                                   const uint8_t *mask,
+                                   uint8_t *failed)
+{
+    return stackGatherPopRange(data, sizes, capacity, values, mask, failed,
+                               0, count);
+}
+
+#if (STACK_SIMD_X86)
+/**
+ * @brief sets failed flags of lanes
+ *
+ * @param failed flags of stacks, can be nullptr
+ * @param begin index of first stack of lanes
+ * @param lanes bit mask of failed lanes
+ * @return number of failed lanes
+ */
+static size_t stackSimdMarkFailed(uint8_t *failed, size_t begin,
+                                  unsigned lanes)
+{
+    size_t marked = (size_t) __builtin_popcount(lanes);
+    if (failed != nullptr)
+    {
+        for (; lanes != 0; lanes &= lanes - 1)
+            failed[begin + (size_t) __builtin_ctz(lanes)] = 1;
+    }
+    return marked;
+}
+
+__attribute__((target("avx2")))
+static __m256i stackSimdSelectAvx2(const uint8_t *mask, size_t begin)
+{
+    if (mask == nullptr)
+        return _mm256_set1_epi32(-1);
+
+    __m256i flags = _mm256_cvtepu8_epi32(
+        _mm_loadl_epi64((const __m128i *) (mask + begin)));
+    return _mm256_cmpgt_epi32(flags, _mm256_setzero_si256());
+}
+
+__attribute__((target("avx2")))
+static __m256i stackSimdIndexAvx2(size_t begin, size_t capacity,
+                                  __m256i sizes)
+{
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i stacks = _mm256_add_epi32(_mm256_set1_epi32((int) begin), lanes);
+    return _mm256_add_epi32(
+        _mm256_mullo_epi32(stacks, _mm256_set1_epi32((int) capacity)),
+        sizes);
+}
+
+__attribute__((target("avx2")))
+static unsigned stackSimdLanesAvx2(__m256i lanes)
+{
+    return (unsigned) _mm256_movemask_ps(_mm256_castsi256_ps(lanes));
+}
+
+__attribute__((target("avx2")))
+static size_t stackScatterPushAvx2(Elem_t *data,
+                                   StackSize_t *sizes,
+                                   size_t count,
+                                   size_t capacity,
+                                   const Elem_t *values,
+                                   const uint8_t *mask,
+                                   uint8_t *failed)
+{
+    const __m256i capacities = _mm256_set1_epi32((int) capacity);
+    size_t full = 0;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i selected = stackSimdSelectAvx2(mask, i);
+        __m256i size = _mm256_loadu_si256((const __m256i *) (sizes + i));
+        __m256i isFull = _mm256_and_si256(
+            selected, _mm256_cmpeq_epi32(size, capacities));
+        __m256i pushed = _mm256_andnot_si256(isFull, selected);
+
+        // AVX2 has no scatter, so only stores are done lane by lane
+        alignas(32) int32_t indices[8] = {};
+        _mm256_store_si256((__m256i *) indices,
+                           stackSimdIndexAvx2(i, capacity, size));
+        for (unsigned lanes = stackSimdLanesAvx2(pushed); lanes != 0;
+             lanes &= lanes - 1)
+        {
+            unsigned lane = (unsigned) __builtin_ctz(lanes);
+            data[indices[lane]] = values[i + lane];
+        }
+
+        _mm256_storeu_si256((__m256i *) (sizes + i),
+                            _mm256_sub_epi32(size, pushed));
+        full += stackSimdMarkFailed(failed, i, stackSimdLanesAvx2(isFull));
+    }
+    return full + stackScatterPushRange(data, sizes, capacity, values, mask,
+                                        failed, i, count);
+}
+
+__attribute__((target("avx2")))
+static size_t stackGatherPopAvx2(Elem_t *data,
+                                 StackSize_t *sizes,
+                                 size_t count,
+                                 size_t capacity,
+                                 Elem_t *values,
+                                 const uint8_t *mask,
+                                 uint8_t *failed)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    size_t empty = 0;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i selected = stackSimdSelectAvx2(mask, i);
+        __m256i size = _mm256_loadu_si256((const __m256i *) (sizes + i));
+        __m256i isEmpty = _mm256_and_si256(selected,
+                                           _mm256_cmpeq_epi32(size, zero));
+        __m256i popped = _mm256_andnot_si256(isEmpty, selected);
+
+        // popped lanes are -1
+        size = _mm256_add_epi32(size, popped);
+        __m256i index = stackSimdIndexAvx2(i, capacity, size);
+        __m256i value = _mm256_mask_i32gather_epi32(zero,
+                                                    (const int *) data,
+                                                    index,
+                                                    popped,
+                                                    sizeof(Elem_t));
+        _mm256_maskstore_epi32((int *) (values + i), selected, value);
+#if (PoisonProtection)
+        alignas(32) int32_t indices[8] = {};
+        _mm256_store_si256((__m256i *) indices, index);
+        for (unsigned lanes = stackSimdLanesAvx2(popped); lanes != 0;
+             lanes &= lanes - 1)
+            data[indices[__builtin_ctz(lanes)]] = POISON_VALUE;
+#endif
+
+        _mm256_storeu_si256((__m256i *) (sizes + i), size);
+        empty += stackSimdMarkFailed(failed, i, stackSimdLanesAvx2(isEmpty));
+    }
+    return empty + stackGatherPopRange(data, sizes, capacity, values, mask,
+                                       failed, i, count);
+}
+
+__attribute__((target("avx512f")))
+static __mmask16 stackSimdSelectAvx512(const uint8_t *mask, size_t begin)
+{
+    if (mask == nullptr)
+        return (__mmask16) 0xFFFF;
+
+    __m512i flags = _mm512_cvtepu8_epi32(
+        _mm_loadu_si128((const __m128i *) (mask + begin)));
+    return _mm512_test_epi32_mask(flags, flags);
+}
+
+__attribute__((target("avx512f")))
+static __m512i stackSimdIndexAvx512(size_t begin, size_t capacity,
+                                    __m512i sizes)
+{
+    const __m512i lanes = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7,
+                                            8, 9, 10, 11, 12, 13, 14, 15);
+    __m512i stacks = _mm512_add_epi32(_mm512_set1_epi32((int) begin), lanes);
+    return _mm512_add_epi32(
+        _mm512_mullo_epi32(stacks, _mm512_set1_epi32((int) capacity)),
+        sizes);
+}
+
+__attribute__((target("avx512f")))
+static size_t stackScatterPushAvx512(Elem_t *data,
+                                     StackSize_t *sizes,
+                                     size_t count,
+                                     size_t capacity,
+                                     const Elem_t *values,
+                                     const uint8_t *mask,
+                                     uint8_t *failed)
+{
+    const __m512i capacities = _mm512_set1_epi32((int) capacity);
+    const __m512i one = _mm512_set1_epi32(1);
+    size_t full = 0;
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __mmask16 selected = stackSimdSelectAvx512(mask, i);
+        __m512i size = _mm512_loadu_si512((const void *) (sizes + i));
+        __mmask16 isFull = _mm512_mask_cmpeq_epi32_mask(selected, size,
+                                                        capacities);
+        __mmask16 pushed = (__mmask16) (selected & ~isFull);
+
+        _mm512_mask_i32scatter_epi32((void *) data,
+                                     pushed,
+                                     stackSimdIndexAvx512(i, capacity, size),
+                                     _mm512_loadu_si512(
+                                         (const void *) (values + i)),
+                                     sizeof(Elem_t));
+        _mm512_storeu_si512((void *) (sizes + i),
+                            _mm512_mask_add_epi32(size, pushed, size, one));
+        full += stackSimdMarkFailed(failed, i, isFull);
+    }
+    return full + stackScatterPushRange(data, sizes, capacity, values, mask,
+                                        failed, i, count);
+}
+
+__attribute__((target("avx512f")))
+static size_t stackGatherPopAvx512(Elem_t *data,
+                                   StackSize_t *sizes,
+                                   size_t count,
+                                   size_t capacity,
+                                   Elem_t *values,
+                                   const uint8_t *mask,
+                                   uint8_t *failed)
+{
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i one = _mm512_set1_epi32(1);
+    size_t empty = 0;
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __mmask16 selected = stackSimdSelectAvx512(mask, i);
+        __m512i size = _mm512_loadu_si512((const void *) (sizes + i));
+        __mmask16 popped = _mm512_mask_cmpneq_epi32_mask(selected, size,
+                                                         zero);
+        __mmask16 isEmpty = (__mmask16) (selected & ~popped);
+
+        size = _mm512_mask_sub_epi32(size, popped, size, one);
+        __m512i index = stackSimdIndexAvx512(i, capacity, size);
+        __m512i value = _mm512_mask_i32gather_epi32(zero,
+                                                    popped,
+                                                    index,
+                                                    (const void *) data,
+                                                    sizeof(Elem_t));
+        _mm512_mask_storeu_epi32((void *) (values + i), selected, value);
+#if (PoisonProtection)
+        _mm512_mask_i32scatter_epi32((void *) data,
+                                     popped,
+                                     index,
+                                     _mm512_set1_epi32(POISON_VALUE),
+                                     sizeof(Elem_t));
+#endif
+
+        _mm512_storeu_si512((void *) (sizes + i), size);
+        empty += stackSimdMarkFailed(failed, i, isEmpty);
+    }
+    return empty + stackGatherPopRange(data, sizes, capacity, values, mask,
+                                       failed, i, count);
+}
+
+static const StackScatterPushKernel STACK_SCATTER_PUSH[STACK_SIMD_LEVELS] = {
+    stackScatterPushScalar,
+    stackScatterPushScalar,
+    stackScatterPushAvx2,
+    stackScatterPushAvx512,
+};
+
+static const StackGatherPopKernel STACK_GATHER_POP[STACK_SIMD_LEVELS] = {
+    stackGatherPopScalar,
+    stackGatherPopScalar,
+    stackGatherPopAvx2,
+    stackGatherPopAvx512,
+};
+#else
+static const StackScatterPushKernel STACK_SCATTER_PUSH[STACK_SIMD_LEVELS] = {
+    stackScatterPushScalar,
+    stackScatterPushScalar,
+    stackScatterPushScalar,
+    stackScatterPushScalar,
+};
+
+static const StackGatherPopKernel STACK_GATHER_POP[STACK_SIMD_LEVELS] = {
+    stackGatherPopScalar,
+    stackGatherPopScalar,
+    stackGatherPopScalar,
+    stackGatherPopScalar,
+};
+#endif
+
+static const char *const STACK_SIMD_NAMES[STACK_SIMD_LEVELS] = {
+    "scalar", "sse2", "avx2", "avx512"
+};
+
+/// -1 until first kernel call or stackSimdSetLevel
+static std::atomic<int> STACK_SIMD_LEVEL(-1);
+
+StackSimdLevel stackSimdDetect()
+{
+#if (STACK_SIMD_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return STACK_SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2"))
+        return STACK_SIMD_AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return STACK_SIMD_SSE2;
+#endif
+    return STACK_SIMD_SCALAR;
+}
+
+StackSimdLevel stackSimdSetLevel(StackSimdLevel level)
+{
+    StackSimdLevel supported = stackSimdDetect();
+    if (level > supported)
+        level = supported;
+
+    STACK_SIMD_LEVEL.store(level, std::memory_order_relaxed);
+    return level;
+}
+
+StackSimdLevel stackSimdGetLevel()
+{
+    int level = STACK_SIMD_LEVEL.load(std::memory_order_relaxed);
+    if (STACK_UNLIKELY(level < 0))
+        return stackSimdSetLevel(STACK_SIMD_AVX512);
+
+    return (StackSimdLevel) level;
+}
+
+const char *stackSimdName(StackSimdLevel level)
+{
+    assert(level < STACK_SIMD_LEVELS);
+
+    return STACK_SIMD_NAMES[level];
+}
+
+#if (PoisonProtection)
+size_t stackFindPoison(const Elem_t *data, size_t count)
+{
+    assert(data != nullptr or count == 0);
+
+    return STACK_FIND_POISON[stackSimdGetLevel()](data, count);
+}
+
+void stackFillPoison(Elem_t *data, size_t count)
+{
+    assert(data != nullptr or count == 0);
+
+    STACK_FILL_POISON[stackSimdGetLevel()](data, count);
+}
+#endif
+
+/**
+ * @brief gets level of batch kernels, vector kernels address elements by
+ * 32-bit indices
+ */
+static StackSimdLevel stackBatchSimdLevel(size_t count, size_t capacity)
+{
+    if (capacity != 0 and count > (size_t) INT32_MAX / capacity)
+        return STACK_SIMD_SCALAR;
+
+    return stackSimdGetLevel();
+}
+
+size_t stackScatterPush(Elem_t *data,
+                        StackSize_t *sizes,
+                        size_t count,
+                        size_t capacity,
+                        const Elem_t *values,
+                        const uint8_t *mask,
+                        uint8_t *failed)
+{
+    assert(data != nullptr or count == 0);
+    assert(sizes != nullptr or count == 0);
+    assert(values != nullptr or count == 0);
+
+    return STACK_SCATTER_PUSH[stackBatchSimdLevel(count, capacity)](
+        data, sizes, count, capacity, values, mask, failed);
+}
+
+size_t stackGatherPop(Elem_t *data,
+                      StackSize_t *sizes,
+                      size_t count,
+                      size_t capacity,
+                      Elem_t *values,
+                      const uint8_t *mask,
+                      uint8_t *failed)
+{
+    assert(data != nullptr or count == 0);
+    assert(sizes != nullptr or count == 0);
+    assert(values != nullptr or count == 0);
+
+    return STACK_GATHER_POP[stackBatchSimdLevel(count, capacity)](
+        data, sizes, count, capacity, values, mask, failed);
+}
@@ -0,0 +1,107 @@
+#ifndef STACK_SIMD_H
+#define STACK_SIMD_H
+
+#include "stack.h"
+
+enum StackSimdLevel
+{
+    STACK_SIMD_SCALAR = 0,
+    STACK_SIMD_SSE2   = 1,
+    STACK_SIMD_AVX2   = 2,
+    STACK_SIMD_AVX512 = 3,
+    STACK_SIMD_LEVELS = 4,
+};
+
+/**
+ * @brief gets best instruction set supported by processor
+ *
+ * @return simd level
+ */
+StackSimdLevel stackSimdDetect();
+
+/**
+ * @brief selects kernels for poison scan and fill and for batch push and
+ * pop, first call of kernel selects best supported level
+ *
+ * @param level wanted level, lowered to supported one
+ * @return selected level
+ */
+StackSimdLevel stackSimdSetLevel(StackSimdLevel level);
+
+/**
+ * @brief gets selected level
+ *
+ * @return simd level
+ */
+StackSimdLevel stackSimdGetLevel();
+
+/**
+ * @brief gets name of level
+ *
+ * @param level simd level
+ * @return name of level
+ */
+const char *stackSimdName(StackSimdLevel level);
+
+#if (PoisonProtection)
+/**
+ * @brief finds first element equal to POISON_VALUE
+ *
+ * @param data elements to scan
+ * @param count number of elements
+ * @return index of first poisoned element or count if there is none
+ */
+size_t stackFindPoison(const Elem_t *data, size_t count);
+
+/**
+ * @brief sets elements to POISON_VALUE
+ *
+ * @param data elements to fill
+ * @param count number of elements
+ */
+void stackFillPoison(Elem_t *data, size_t count);
+#endif
+
+/**
+ * @brief pushes values[i] to stack i of count stacks stored one after
+ * another with same capacity, scatters elements on AVX-512
+ *
+ * @param data buffer of stacks
+ * @param sizes count sizes of stacks
+ * @param count number of stacks
+ * @param capacity capacity of each stack
+ * @param values count values
+ * @param mask count flags, nullptr selects all stacks
+ * @param failed count flags, set to 1 for full stacks, can be nullptr
+ * @return number of full stacks
+ */
+size_t stackScatterPush(Elem_t *data,
+                        StackSize_t *sizes,
+                        size_t count,
+                        size_t capacity,
+                        const Elem_t *values,
+                        const uint8_t *mask,
+                        uint8_t *failed);
+
+/**
+ * @brief extracts top of stack i of count stacks stored one after another
+ * with same capacity to values[i], gathers elements on AVX2 and AVX-512
+ *
+ * @param data buffer of stacks
+ * @param sizes count sizes of stacks
+ * @param count number of stacks
+ * @param capacity capacity of each stack
+ * @param values count variables, value of empty stack is set to 0
+ * @param mask count flags, nullptr selects all stacks
+ * @param failed count flags, set to 1 for empty stacks, can be nullptr
+ * @return number of empty stacks
+ */
+size_t stackGatherPop(Elem_t *data,
+                      StackSize_t *sizes,
+                      size_t count,
+                      size_t capacity,
+                      Elem_t *values,
+                      const uint8_t *mask,
+                      uint8_t *failed);
+
+#endif
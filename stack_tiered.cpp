@@ -0,0 +1,403 @@
+#include "stack_tiered.h"
+#include "stack_verification.h"
+#include "stack_logs.h"
+#include "stack_watchdog.h"
+
+#include <chrono>
+#include <future>
+#include <unistd.h>
+
+struct TieredPrefetch
+{
+    size_t index = 0;
+    Elem_t *buffer = nullptr;
+    uint8_t *scratch = nullptr;
+    std::future<bool> done{};
+};
+
+static size_t tieredSegmentBytes(const TieredStack *stack)
+{
+    return stack->segmentSize * sizeof(Elem_t);
+}
+
+static off_t tieredSegmentOffset(const TieredStack *stack, size_t index)
+{
+    return (off_t) (index * tieredSegmentBytes(stack));
+}
+
+static bool tieredRead(int fd, Elem_t *buffer, size_t bytes, off_t offset)
+{
+    char *data = (char *) buffer;
+    while (bytes != 0)
+    {
+        ssize_t read = pread(fd, data, bytes, offset);
+        if (read <= 0)
+            return false;
+
+        data += read;
+        bytes -= (size_t) read;
+        offset += read;
+    }
+    return true;
+}
+
+static bool tieredWrite(int fd,
+                        const Elem_t *buffer,
+                        size_t bytes,
+                        off_t offset)
+{
+    const char *data = (const char *) buffer;
+    while (bytes != 0)
+    {
+        ssize_t written = pwrite(fd, data, bytes, offset);
+        if (written <= 0)
+            return false;
+
+        data += written;
+        bytes -= (size_t) written;
+        offset += written;
+    }
+    return true;
+}
+
+size_t tieredCompress(const Elem_t *values, size_t count, uint8_t *data)
+{
+    assert(values != nullptr or count == 0);
+    assert(data != nullptr or count == 0);
+
+    size_t bytes = 0;
+    int64_t previous = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        int64_t delta = (int64_t) values[i] - previous;
+        previous = values[i];
+
+        uint64_t zigzag = ((uint64_t) delta << 1) ^ (uint64_t) (delta >> 63);
+        while (zigzag >= 0x80)
+        {
+            data[bytes++] = (uint8_t) (zigzag | 0x80);
+            zigzag >>= 7;
+        }
+        data[bytes++] = (uint8_t) zigzag;
+    }
+    return bytes;
+}
+
+bool tieredDecompress(const uint8_t *data,
+                      size_t bytes,
+                      Elem_t *values,
+                      size_t count)
+{
+    assert(data != nullptr or bytes == 0);
+    assert(values != nullptr or count == 0);
+
+    size_t position = 0;
+    int64_t previous = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        uint64_t zigzag = 0;
+        unsigned shift = 0;
+        uint8_t byte = 0;
+        do
+        {
+            if (position == bytes or shift >= 7 * TIERED_MAX_VARINT_SIZE)
+                return false;
+
+            byte = data[position++];
+            zigzag |= (uint64_t) (byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+
+        previous += (int64_t) (zigzag >> 1) ^ -(int64_t) (zigzag & 1);
+        values[i] = (Elem_t) previous;
+    }
+    return position == bytes;
+}
+
+static void tieredPrefetchStart(TieredStack *stack)
+{
+    TieredPrefetch *prefetch = stack->prefetch;
+    if (stack->storage != TIERED_STORAGE_FILE or prefetch->done.valid()
+        or stack->segmentsCount == 0)
+        return;
+
+    prefetch->index = stack->segmentsCount - 1;
+    prefetch->done = std::async(std::launch::async,
+                                tieredRead,
+                                fileno(stack->file),
+                                prefetch->buffer,
+                                tieredSegmentBytes(stack),
+                                tieredSegmentOffset(stack, prefetch->index));
+}
+
+/**
+ * @brief waits for background read
+ *
+ * @return true if segment index is in prefetch buffer
+ */
+static bool tieredPrefetchTake(TieredStack *stack, size_t index)
+{
+    TieredPrefetch *prefetch = stack->prefetch;
+    if (!prefetch->done.valid())
+        return false;
+
+    bool read = prefetch->done.get();
+    return read and prefetch->index == index;
+}
+
+static size_t tieredStackSpill(TieredStack *stack)
+{
+    tieredPrefetchTake(stack, stack->segmentsCount);
+
+    if (stack->segmentsCount == stack->segmentsCapacity)
+    {
+        size_t newCapacity = stack->segmentsCapacity == 0
+            ? 1 : stack->segmentsCapacity * 2;
+        TieredSegment *newSegments = (TieredSegment *) realloc(
+            stack->segments, newCapacity * sizeof(TieredSegment));
+        if (newSegments == nullptr)
+            return CANT_ALLOCATE_MEMORY;
+
+        stack->segments = newSegments;
+        stack->segmentsCapacity = newCapacity;
+    }
+
+    size_t bytes = tieredSegmentBytes(stack);
+    TieredSegment *segment = &stack->segments[stack->segmentsCount];
+    *segment = {};
+    if (stack->storage == TIERED_STORAGE_COMPRESSED)
+    {
+        uint8_t *scratch = stack->prefetch->scratch;
+        segment->bytes = tieredCompress(stack->hot.data,
+                                        stack->segmentSize,
+                                        scratch);
+        segment->data = (uint8_t *) malloc(segment->bytes);
+        if (segment->data == nullptr)
+            return CANT_ALLOCATE_MEMORY;
+
+        memcpy(segment->data, scratch, segment->bytes);
+    }
+    else
+    {
+        segment->bytes = bytes;
+        if (!tieredWrite(fileno(stack->file),
+                         stack->hot.data,
+                         bytes,
+                         tieredSegmentOffset(stack, stack->segmentsCount)))
+            return CANT_ALLOCATE_MEMORY_FOR_STACK;
+    }
+
+#if (HashProtection)
+    segment->hash = hashData(stack->hot.data, bytes);
+#endif
+    stack->segmentsCount++;
+    stack->stats.spilled++;
+    stack->stats.rawBytes += bytes;
+    stack->stats.storedBytes += segment->bytes;
+
+    size_t hotSize = (size_t) stack->hot.size - stack->segmentSize;
+    STACK_WRITE_GUARD(&stack->hot)
+    memmove(stack->hot.data,
+            stack->hot.data + stack->segmentSize,
+            hotSize * sizeof(Elem_t));
+
+    return stackSyncData(&stack->hot, hotSize);
+}
+
+static size_t tieredStackLoad(TieredStack *stack)
+{
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+
+    size_t index = stack->segmentsCount - 1;
+    size_t bytes = tieredSegmentBytes(stack);
+    Elem_t *buffer = stack->prefetch->buffer;
+    TieredSegment *segment = &stack->segments[index];
+
+    if (stack->storage == TIERED_STORAGE_COMPRESSED)
+    {
+        if (!tieredDecompress(segment->data,
+                              segment->bytes,
+                              buffer,
+                              stack->segmentSize))
+            return STACK_SEGMENT_CORRUPTED;
+    }
+    else if (tieredPrefetchTake(stack, index))
+        stack->stats.prefetched++;
+    else if (!tieredRead(fileno(stack->file),
+                         buffer,
+                         bytes,
+                         tieredSegmentOffset(stack, index)))
+        return STACK_SEGMENT_CORRUPTED;
+
+#if (HashProtection)
+    if (hashData(buffer, bytes) != segment->hash)
+        return STACK_SEGMENT_CORRUPTED;
+#endif
+
+    stack->stats.rawBytes -= bytes;
+    stack->stats.storedBytes -= segment->bytes;
+    free(segment->data);
+    *segment = {};
+    stack->segmentsCount--;
+    stack->stats.loaded++;
+
+    size_t error = stackPushMany(&stack->hot, buffer, stack->segmentSize);
+    stack->stats.loadNanoseconds += (uint64_t)
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    return error;
+}
+
+size_t tieredStackCtor__(TieredStack *stack, TieredStackConfig config)
+{
+    assert(stack != nullptr);
+
+    size_t error = STACK_NO_ERRORS;
+
+    if (config.segmentSize == 0 or config.hotSegments < 2
+        or config.segmentSize * config.hotSegments > STACK_MAX_CAPACITY)
+        return CANT_ALLOCATE_MEMORY_FOR_STACK;
+
+    stack->segments = nullptr;
+    stack->segmentsCount = 0;
+    stack->segmentsCapacity = 0;
+    stack->segmentSize = config.segmentSize;
+    stack->hotSegments = config.hotSegments;
+    stack->storage = config.storage;
+    stack->stats = {};
+
+    stack->file = nullptr;
+    if (stack->storage == TIERED_STORAGE_FILE)
+    {
+        stack->file = tmpfile();
+        if (stack->file == nullptr)
+            return CANT_ALLOCATE_MEMORY_FOR_STACK;
+    }
+
+    stack->prefetch = new TieredPrefetch;
+    stack->prefetch->buffer =
+        (Elem_t *) calloc(config.segmentSize, sizeof(Elem_t));
+    if (stack->storage == TIERED_STORAGE_COMPRESSED)
+        stack->prefetch->scratch = (uint8_t *) calloc(
+            config.segmentSize * TIERED_MAX_VARINT_SIZE, sizeof(uint8_t));
+
+    if (stack->prefetch->buffer == nullptr
+        or (stack->storage == TIERED_STORAGE_COMPRESSED
+            and stack->prefetch->scratch == nullptr))
+    {
+        free(stack->prefetch->buffer);
+        free(stack->prefetch->scratch);
+        delete stack->prefetch;
+        stack->prefetch = nullptr;
+        if (stack->file != nullptr)
+            fclose(stack->file);
+        stack->file = nullptr;
+        return CANT_ALLOCATE_MEMORY;
+    }
+
+    error = stackCtor__(&stack->hot, 0);
+    if (error)
+        return error;
+
+    TIERED_ASSERT_OK(stack, &error)
+
+    return error;
+}
+
+size_t tieredStackPush(TieredStack *stack, Elem_t value)
+{
+    assert(stack != nullptr);
+
+    size_t error = STACK_NO_ERRORS;
+
+    TIERED_ASSERT_OK(stack, &error)
+    if (error)
+        return error;
+
+    if (stack->hot.size == stack->hotSegments * stack->segmentSize)
+        error = tieredStackSpill(stack);
+    if (error)
+        return error;
+
+    return stackPush(&stack->hot, value);
+}
+
+size_t tieredStackPop(TieredStack *stack, Elem_t *value)
+{
+    assert(stack != nullptr);
+    assert(value != nullptr);
+
+    size_t error = STACK_NO_ERRORS;
+
+    TIERED_ASSERT_OK(stack, &error)
+    if (error)
+        return error;
+
+    if (stack->hot.size == 0 and stack->segmentsCount != 0)
+        error = tieredStackLoad(stack);
+    if (error)
+        return error;
+
+    error = stackPop(&stack->hot, value);
+    if (stack->hot.size < stack->segmentSize)
+        tieredPrefetchStart(stack);
+
+    return error;
+}
+
+size_t tieredStackSize(const TieredStack *stack)
+{
+    assert(stack != nullptr);
+
+    return (size_t) stack->hot.size
+        + stack->segmentsCount * stack->segmentSize;
+}
+
+size_t tieredStackVerifier(TieredStack *stack)
+{
+    if (stack == nullptr)
+        return STACK_NULLPTR;
+
+    size_t error = stackVerifier(&stack->hot);
+    if (error)
+        return error;
+
+    if ((stack->storage == TIERED_STORAGE_FILE and stack->file == nullptr)
+        or stack->prefetch == nullptr
+        or stack->segmentsCount > stack->segmentsCapacity
+        or stack->hot.size > stack->hotSegments * stack->segmentSize)
+        error |= STACK_SEGMENT_CORRUPTED;
+
+    return error;
+}
+
+size_t tieredStackDtor(TieredStack *stack)
+{
+    assert(stack != nullptr);
+
+    size_t error = STACK_NO_ERRORS;
+
+    TIERED_ASSERT_OK(stack, &error)
+    if (error)
+        return error;
+
+    tieredPrefetchTake(stack, 0);
+    free(stack->prefetch->buffer);
+    free(stack->prefetch->scratch);
+    delete stack->prefetch;
+    stack->prefetch = nullptr;
+
+    if (stack->file != nullptr)
+        fclose(stack->file);
+    stack->file = nullptr;
+
+    for (size_t i = 0; i < stack->segmentsCount; i++)
+        free(stack->segments[i].data);
+    free(stack->segments);
+    stack->segments = nullptr;
+    stack->segmentsCount = 0;
+    stack->segmentsCapacity = 0;
+
+    return stackDtor(&stack->hot);
+}
@@ -0,0 +1,189 @@
+#ifndef STACK_TIERED_H
+#define STACK_TIERED_H
+
+#include "stack.h"
+
+const size_t TIERED_SEGMENT_SIZE = 1 << 12;
+const size_t TIERED_HOT_SEGMENTS = 4;
+const size_t TIERED_MAX_VARINT_SIZE = 5;
+
+enum TieredStorage
+{
+    TIERED_STORAGE_FILE       = 0,
+    TIERED_STORAGE_COMPRESSED = 1,
+};
+
+/**
+ * @brief elements deeper than segmentSize * hotSegments are cold
+ */
+struct TieredStackConfig
+{
+    size_t segmentSize = TIERED_SEGMENT_SIZE;
+    size_t hotSegments = TIERED_HOT_SEGMENTS;
+    TieredStorage storage = TIERED_STORAGE_FILE;
+};
+
+/**
+ * @brief cold segment of elements
+ *
+ * With TIERED_STORAGE_FILE segment i is stored at offset
+ * i * segmentSize * sizeof(Elem_t) of spill file and data is nullptr.
+ * With TIERED_STORAGE_COMPRESSED data holds compressed elements.
+ */
+struct TieredSegment
+{
+    size_t hash = 0;
+    uint8_t *data = nullptr;
+    size_t bytes = 0;
+};
+
+/**
+ * @brief counters of tiered stack, bytes are counted for segments which
+ * are cold now
+ */
+struct TieredStackStats
+{
+    size_t spilled = 0;
+    size_t loaded = 0;
+    size_t prefetched = 0;
+    size_t rawBytes = 0;
+    size_t storedBytes = 0;
+    uint64_t loadNanoseconds = 0;
+};
+
+struct TieredPrefetch;
+
+/**
+ * @brief stack which keeps top hotSegments segments in memory and spills
+ * colder ones to temporary file or compresses them
+ *
+ * When hot part becomes full its bottom segment is written to file. When
+ * pops come within one segment of spilled part, top spilled segment is
+ * read in background, so pop which empties hot part usually doesn't wait
+ * for disk. Compressed segments are decompressed when pop empties hot
+ * part.
+ */
+struct TieredStack
+{
+    Stack hot = {};
+    TieredSegment *segments = nullptr;
+    size_t segmentsCount = 0;
+    size_t segmentsCapacity = 0;
+    size_t segmentSize = 0;
+    size_t hotSegments = 0;
+    TieredStorage storage = TIERED_STORAGE_FILE;
+    FILE *file = nullptr;
+    TieredPrefetch *prefetch = nullptr;
+    TieredStackStats stats = {};
+};
+
+/**
+ * @brief constructor for tiered stack
+ *
+ * @param stack stack for constructing
+ * @param config sizes of segments and hot part
+ * @return error code
+ */
+size_t tieredStackCtor__(TieredStack *stack, TieredStackConfig config);
+
+/**
+ * @brief macro constructor for tiered stack
+ *
+ * @param tiered stack for constructing
+ * @param config sizes of segments and hot part
+ * @param error error code
+ * @return void
+ */
+#define tieredStackCtor(tiered, config, error)                         \
+{                                                                      \
+    static const StackInfoId stackInfoId_ = stackInfoRegister(         \
+        {__LINE__, __FILE__, __PRETTY_FUNCTION__, #tiered});           \
+    (tiered)->hot.infoId = stackInfoId_;                               \
+    *(error) = tieredStackCtor__((tiered), (config));                  \
+}
+
+/**
+ * @brief pushes element, spills bottom hot segment if hot part is full
+ *
+ * @param stack stack for pushing
+ * @param value pushing value
+ * @return error code
+ */
+size_t tieredStackPush(TieredStack *stack, Elem_t value);
+
+/**
+ * @brief extracts last element, loads spilled segment if hot part is empty
+ *
+ * @param stack stack for extracting
+ * @param value variable for storing extracted element
+ * @return error code
+ */
+size_t tieredStackPop(TieredStack *stack, Elem_t *value);
+
+/**
+ * @brief gets number of hot and cold elements
+ *
+ * @param stack stack to measure
+ * @return number of elements
+ */
+size_t tieredStackSize(const TieredStack *stack);
+
+/**
+ * @brief compresses elements with delta and zigzag varint coding
+ *
+ * @param values elements to compress
+ * @param count number of elements
+ * @param data buffer of at least count * TIERED_MAX_VARINT_SIZE bytes
+ * @return number of written bytes
+ */
+size_t tieredCompress(const Elem_t *values, size_t count, uint8_t *data);
+
+/**
+ * @brief decompresses elements compressed by tieredCompress
+ *
+ * @param data compressed elements
+ * @param bytes size of data
+ * @param values buffer for elements
+ * @param count number of elements
+ * @return true if data has exactly count elements
+ */
+bool tieredDecompress(const uint8_t *data,
+                      size_t bytes,
+                      Elem_t *values,
+                      size_t count);
+
+/**
+ * @brief checks if tiered stack is correct, spilled segments are checked
+ * when they are loaded
+ *
+ * @param stack stack for checking
+ * @return error code
+ */
+size_t tieredStackVerifier(TieredStack *stack);
+
+/**
+ * @brief destructor for tiered stack, removes spill file
+ *
+ * @param stack stack for destructing
+ * @return error code
+ */
+size_t tieredStackDtor(TieredStack *stack);
+
+/**
+ * @brief macro for checking if tiered stack is correct
+ *
+ * @param tiered stack for checking
+ * @param error error code
+ */
+#define TIERED_ASSERT_OK(tiered, error)                                \
+{                                                                      \
+    *(error) = tieredStackVerifier((tiered));                          \
+    if (STACK_UNLIKELY(*(error)))                                      \
+    {                                                                  \
+        StackInfo info = {__LINE__, __FILE__, __PRETTY_FUNCTION__,     \
+                          #tiered};                                    \
+        stackDump(&(tiered)->hot, &(info), *(error), printElem_t);     \
+    }                                                                  \
+}
+
+#endif
@@ -0,0 +1,180 @@
+#include "stack_trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+struct StackTraceBuffer
+{
+    std::vector<StackTraceRecord> records;
+    uint8_t thread = 0;
+
+    StackTraceBuffer();
+    ~StackTraceBuffer();
+    StackTraceBuffer(const StackTraceBuffer &) = delete;
+    StackTraceBuffer &operator=(const StackTraceBuffer &) = delete;
+};
+
+static std::atomic<bool> STACK_TRACE_ENABLED(false);
+static std::atomic<uint8_t> STACK_TRACE_THREADS(0);
+static std::chrono::steady_clock::time_point STACK_TRACE_START;
+
+static std::mutex STACK_TRACE_MUTEX;
+static FILE *STACK_TRACE_FILE = nullptr;
+static std::vector<StackTraceBuffer *> STACK_TRACE_BUFFERS;
+
+static void stackTraceFlush(StackTraceBuffer *buffer)
+{
+    if (STACK_TRACE_FILE != nullptr and !buffer->records.empty())
+        fwrite(buffer->records.data(),
+               sizeof(StackTraceRecord),
+               buffer->records.size(),
+               STACK_TRACE_FILE);
+
+    buffer->records.clear();
+}
+
+StackTraceBuffer::StackTraceBuffer() :
+    records(),
+    thread(STACK_TRACE_THREADS.fetch_add(1))
+{
+    records.reserve(STACK_TRACE_BUFFER_SIZE);
+
+    std::lock_guard<std::mutex> lock(STACK_TRACE_MUTEX);
+    STACK_TRACE_BUFFERS.push_back(this);
+}
+
+StackTraceBuffer::~StackTraceBuffer()
+{
+    std::lock_guard<std::mutex> lock(STACK_TRACE_MUTEX);
+    stackTraceFlush(this);
+    STACK_TRACE_BUFFERS.erase(std::find(STACK_TRACE_BUFFERS.begin(),
+                                        STACK_TRACE_BUFFERS.end(),
+                                        this));
+}
+
+size_t stackTraceStart(const char *filename)
+{
+    assert(filename != nullptr);
+
+    std::lock_guard<std::mutex> lock(STACK_TRACE_MUTEX);
+    if (STACK_TRACE_FILE != nullptr)
+        return STACK_TRACE_INCORRECT;
+
+    FILE *fp = fopen(filename, "wb");
+    if (fp == nullptr)
+        return STACK_TRACE_INCORRECT;
+
+    uint32_t recordSize = sizeof(StackTraceRecord);
+    fwrite(STACK_TRACE_MAGIC, sizeof(STACK_TRACE_MAGIC), 1, fp);
+    fwrite(&STACK_TRACE_VERSION, sizeof(STACK_TRACE_VERSION), 1, fp);
+    fwrite(&recordSize, sizeof(recordSize), 1, fp);
+
+    STACK_TRACE_FILE = fp;
+    STACK_TRACE_START = std::chrono::steady_clock::now();
+    STACK_TRACE_ENABLED.store(true);
+
+    return STACK_NO_ERRORS;
+}
+
+void stackTraceStop()
+{
+    STACK_TRACE_ENABLED.store(false);
+
+    std::lock_guard<std::mutex> lock(STACK_TRACE_MUTEX);
+    if (STACK_TRACE_FILE == nullptr)
+        return;
+
+    for (StackTraceBuffer *buffer: STACK_TRACE_BUFFERS)
+        stackTraceFlush(buffer);
+
+    fclose(STACK_TRACE_FILE);
+    STACK_TRACE_FILE = nullptr;
+}
+
+void stackTraceRecord(const void *stack, StackTraceOp op, Elem_t value)
+{
+    if (!STACK_TRACE_ENABLED.load(std::memory_order_relaxed))
+        return;
+
+    static thread_local StackTraceBuffer buffer;
+
+    StackTraceRecord record = {};
+    record.time = (uint64_t) std::chrono::duration_cast<
+        std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - STACK_TRACE_START).count();
+    record.stack = (uint64_t) (uintptr_t) stack;
+    record.value = value;
+    record.op = (uint8_t) op;
+    record.thread = buffer.thread;
+    buffer.records.push_back(record);
+
+    if (buffer.records.size() == STACK_TRACE_BUFFER_SIZE)
+    {
+        std::lock_guard<std::mutex> lock(STACK_TRACE_MUTEX);
+        stackTraceFlush(&buffer);
+    }
+}
+
+size_t stackTraceRead(const char *filename,
+                      StackTraceRecord **records,
+                      size_t *count)
+{
+    assert(filename != nullptr);
+    assert(records != nullptr);
+    assert(count != nullptr);
+
+    *records = nullptr;
+    *count = 0;
+
+    FILE *fp = fopen(filename, "rb");
+    if (fp == nullptr)
+        return STACK_TRACE_INCORRECT;
+
+    char magic[sizeof(STACK_TRACE_MAGIC)] = {};
+    uint32_t version = 0;
+    uint32_t recordSize = 0;
+    if (fread(magic, sizeof(magic), 1, fp) != 1
+        or fread(&version, sizeof(version), 1, fp) != 1
+        or fread(&recordSize, sizeof(recordSize), 1, fp) != 1
+        or memcmp(magic, STACK_TRACE_MAGIC, sizeof(magic)) != 0
+        or version != STACK_TRACE_VERSION
+        or recordSize != sizeof(StackTraceRecord))
+    {
+        fclose(fp);
+        return STACK_TRACE_INCORRECT;
+    }
+
+    size_t error = STACK_NO_ERRORS;
+    size_t capacity = 0;
+    StackTraceRecord record = {};
+    while (fread(&record, sizeof(record), 1, fp) == 1)
+    {
+        if (*count == capacity)
+        {
+            capacity = capacity == 0 ? STACK_TRACE_BUFFER_SIZE : capacity * 2;
+            StackTraceRecord *newRecords = (StackTraceRecord *) realloc(
+                *records, capacity * sizeof(StackTraceRecord));
+            if (newRecords == nullptr)
+            {
+                error |= CANT_ALLOCATE_MEMORY;
+                break;
+            }
+            *records = newRecords;
+        }
+        (*records)[(*count)++] = record;
+    }
+
+    if (!error and !feof(fp))
+        error |= STACK_TRACE_INCORRECT;
+    fclose(fp);
+
+    std::stable_sort(*records, *records + *count,
+                     [](const StackTraceRecord &a, const StackTraceRecord &b)
+                     {
+                         return a.time < b.time;
+                     });
+    return error;
+}
@@ -0,0 +1,76 @@
+#ifndef STACK_TRACE_H
+#define STACK_TRACE_H
+
+#include "stack.h"
+
+const char STACK_TRACE_MAGIC[8] = {'S', 'T', 'K', 'T', 'R', 'A', 'C', 'E'};
+const uint32_t STACK_TRACE_VERSION = 1;
+const size_t STACK_TRACE_BUFFER_SIZE = 4096;
+
+enum StackTraceOp
+{
+    TRACE_CTOR   = 0,
+    TRACE_PUSH   = 1,
+    TRACE_POP    = 2,
+    TRACE_RESIZE = 3,
+    TRACE_DTOR   = 4,
+    TRACE_OPS_COUNT,
+};
+
+/**
+ * @brief one traced call, written to trace file as is
+ *
+ * value is pushed or popped element for TRACE_PUSH and TRACE_POP and
+ * capacity for TRACE_CTOR and TRACE_RESIZE.
+ */
+struct StackTraceRecord
+{
+    uint64_t time = 0;
+    uint64_t stack = 0;
+    Elem_t value = 0;
+    uint8_t op = TRACE_CTOR;
+    uint8_t thread = 0;
+    uint16_t reserved = 0;
+};
+
+static_assert(sizeof(StackTraceRecord) == 24,
+              "Trace record must have same size on all platforms");
+
+/**
+ * @brief starts writing trace of stack calls to file
+ *
+ * @param filename name of trace file
+ * @return error code
+ */
+size_t stackTraceStart(const char *filename);
+
+/**
+ * @brief flushes buffers of all threads and closes trace file
+ *
+ * Threads must not call stack functions while trace is stopped.
+ */
+void stackTraceStop();
+
+/**
+ * @brief adds call to buffer of current thread, does nothing if trace
+ * is not started
+ *
+ * @param stack stack which was called
+ * @param op traced operation
+ * @param value element or capacity
+ */
+void stackTraceRecord(const void *stack, StackTraceOp op, Elem_t value);
+
+/**
+ * @brief reads trace file, records of all threads are sorted by time
+ *
+ * @param filename name of trace file
+ * @param records array of records, must be freed with free
+ * @param count number of records
+ * @return error code
+ */
+size_t stackTraceRead(const char *filename,
+                      StackTraceRecord **records,
+                      size_t *count);
+
+#endif
@@ -1,4 +1,5 @@
 #include "stack_verification.h"
+#include "stack_simd.h"
 
 #if (PoisonProtection)
 bool isPoison(Elem_t value)
@@ -13,13 +14,68 @@ void stackVerifyPoison(Stack *stack, size_t *error)
     assert(stack != nullptr);
     assert(error != nullptr);
 
-    for (size_t i = 0; i < stack->size; i++)
+    if (stackFindPoison(stack->data, stack->size) != stack->size)
+        *error |= STACK_POISONED_DATA;
+}
+#endif
+
+#if (CanaryProtection)
+void stackVerifyStructCanaries(Canary canaryStart,
+                               Canary canaryEnd,
+                               size_t *error)
+{
+    assert(error != nullptr);
+
+    if (canaryStart != CANARY_START)
+    {
+        if (canaryStart == CANARY_POISONED)
+        {
+            *error |= STACK_START_STRUCT_CANARY_POISONED;
+        }
+        else
+            *error |= STACK_START_STRUCT_CANARY_DEAD;
+    }
+
+    if (canaryEnd != CANARY_END)
+    {
+        if (canaryEnd == CANARY_POISONED)
+        {
+            *error |= STACK_END_STRUCT_CANARY_POISONED;
+        }
+        else
+            *error |= STACK_END_STRUCT_CANARY_DEAD;
+    }
+}
+
+STACK_NO_SANITIZE_ADDRESS
+void stackVerifyDataCanaries(const void *data, size_t dataSize, size_t *error)
+{
+    assert(data != nullptr);
+    assert(error != nullptr);
+
+    const Canary *canary_start =
+        (const Canary *) ((const char *) data - sizeof(Canary));
+    if (*canary_start != CANARY_START)
+    {
+        if (*canary_start == CANARY_POISONED)
+        {
+            *error |= STACK_START_DATA_CANARY_POISONED;
+        }
+        else
+            *error |= STACK_START_DATA_CANARY_DEAD;
+    }
+
+    const Canary *canary_end =
+        (const Canary *) ((const char *) data + dataSize);
+
+    if (*canary_end != CANARY_END)
     {
-        if (isPoison(stack->data[i]))
+        if (*canary_end == CANARY_POISONED)
         {
-            *error |= STACK_POISONED_DATA;
-            break;
+            *error |= STACK_END_DATA_CANARY_POISONED;
         }
+        else
+            *error |= STACK_END_DATA_CANARY_DEAD;
     }
 }
 #endif
@@ -39,13 +95,13 @@ size_t stackVerifier(Stack *stack)
         return error;
     }
 
-    if (stack->size == (size_t) POISON_INT_VALUE)
+    if (stack->size == (StackSize_t) POISON_INT_VALUE)
     {
         error |= STACK_POISONED_SIZE_ERR;
         return error;
     }
 
-    if (stack->capacity == (size_t) POISON_INT_VALUE)
+    if (stack->capacity == (StackSize_t) POISON_INT_VALUE)
     {
         error |= STACK_POISONED_CAPACITY_ERR;
         return error;
@@ -58,11 +114,13 @@ size_t stackVerifier(Stack *stack)
     }
 #if (PoisonProtection)
     if (stack->data == POISON_PTR or stack->data == nullptr)
+#else
+    if (stack->data == nullptr)
+#endif
     {
         error |= STACK_POISON_PTR_ERR;
         return error;
     }
-#endif
 
 #if (PoisonProtection)
     stackVerifyPoison(stack, &error);
@@ -80,50 +138,10 @@ size_t stackVerifier(Stack *stack)
 # endif
 
 # if (CanaryProtection)
-    if (stack->canary_start != CANARY_START)
-    {
-        if (stack->canary_start == CANARY_POISONED)
-        {
-            error |= STACK_START_STRUCT_CANARY_POISONED;
-        }
-        else
-            error |= STACK_START_STRUCT_CANARY_DEAD;
-    }
-
-    if (stack->canary_end != CANARY_END)
-    {
-        if (stack->canary_end == CANARY_POISONED)
-        {
-            error |= STACK_END_STRUCT_CANARY_POISONED;
-        }
-        else
-            error |= STACK_END_STRUCT_CANARY_DEAD;
-    }
-
-    Canary *canary_start =
-        (Canary *) ((char *) stack->data - sizeof(Canary));
-    if (*canary_start != CANARY_START)
-    {
-        if (*canary_start == CANARY_POISONED)
-        {
-            error |= STACK_START_DATA_CANARY_POISONED;
-        }
-        else
-            error |= STACK_START_DATA_CANARY_DEAD;
-    }
-
-    Canary *canary_end = (Canary *) ((char *) stack->data
-        + sizeof(Elem_t) * stack->capacity);
-
-    if (*canary_end != CANARY_END)
-    {
-        if (*canary_end == CANARY_POISONED)
-        {
-            error |= STACK_END_DATA_CANARY_POISONED;
-        }
-        else
-            error |= STACK_END_DATA_CANARY_DEAD;
-    }
+    stackVerifyStructCanaries(stack->canary_start, stack->canary_end, &error);
+    stackVerifyDataCanaries(stack->data,
+                            sizeof(Elem_t) * (size_t) stack->capacity,
+                            &error);
 # endif
 
     return error;
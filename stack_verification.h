@@ -19,6 +19,28 @@ bool isPoison(Elem_t value);
  */
 void stackVerifyPoison(Stack *stack, size_t *error);
 
+#if (CanaryProtection)
+/**
+ * @brief checks canaries of struct
+ *
+ * @param canaryStart start canary of struct
+ * @param canaryEnd end canary of struct
+ * @param error error code
+ */
+void stackVerifyStructCanaries(Canary canaryStart,
+                               Canary canaryEnd,
+                               size_t *error);
+
+/**
+ * @brief checks canaries around data buffer
+ *
+ * @param data buffer allocated by stackReallocData
+ * @param dataSize size of buffer in bytes
+ * @param error error code
+ */
+void stackVerifyDataCanaries(const void *data, size_t dataSize, size_t *error);
+#endif
+
 /**
  * @brief Checks if stack is correct
  *
@@ -35,10 +57,11 @@ size_t stackVerifier(Stack *stack);
  */
 #define ASSERT_OK(stack, error)                                        \
 {                                                                      \
-    StackInfo info = {__LINE__, __FILE__, __PRETTY_FUNCTION__, #stack};\
     *(error) = stackVerifier((stack));                                 \
-    if (*(error))                                                      \
+    if (STACK_UNLIKELY(*(error)))                                      \
     {                                                                  \
+        StackInfo info = {__LINE__, __FILE__, __PRETTY_FUNCTION__,     \
+                          #stack};                                     \
         stackDump((stack), &(info), *(error), printElem_t);            \
     }                                                                  \
 }
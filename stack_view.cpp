@@ -0,0 +1,98 @@
+#include "stack_view.h"
+#include "stack_verification.h"
+#include "stack_logs.h"
+
+#include <algorithm>
+#include <execution>
+#include <functional>
+#include <numeric>
+
+size_t stackViewCreate(Stack *stack, StackView *view)
+{
+    assert(view != nullptr);
+
+    size_t error = STACK_NO_ERRORS;
+
+    *view = {};
+    ASSERT_OK(stack, &error)
+    if (error)
+        return error;
+
+    view->stack = stack;
+    view->data = stack->data;
+    view->size = stack->size;
+    view->generation = stack->generation;
+
+    return error;
+}
+
+size_t stackViewVerify(const StackView *view)
+{
+    assert(view != nullptr);
+
+    const Stack *stack = view->stack;
+    if (stack == nullptr)
+        return STACK_NULLPTR;
+
+    if (!stack->alive or stack->generation != view->generation
+        or stack->data != view->data or stack->size != view->size)
+        return STACK_VIEW_INVALID;
+
+    return STACK_NO_ERRORS;
+}
+
+size_t stackViewSum(const StackView *view, int64_t *sum)
+{
+    assert(view != nullptr);
+    assert(sum != nullptr);
+
+    size_t error = stackViewVerify(view);
+    if (error)
+        return error;
+
+    *sum = std::transform_reduce(std::execution::par_unseq,
+                                 view->begin(),
+                                 view->end(),
+                                 (int64_t) 0,
+                                 std::plus<int64_t>(),
+                                 [](Elem_t value)
+                                 {
+                                     return (int64_t) value;
+                                 });
+
+    return stackViewVerify(view);
+}
+
+size_t stackViewCount(const StackView *view, Elem_t value, size_t *count)
+{
+    assert(view != nullptr);
+    assert(count != nullptr);
+
+    size_t error = stackViewVerify(view);
+    if (error)
+        return error;
+
+    *count = (size_t) std::count(std::execution::par_unseq,
+                                 view->begin(),
+                                 view->end(),
+                                 value);
+
+    return stackViewVerify(view);
+}
+
+size_t stackViewFind(const StackView *view, Elem_t value, size_t *index)
+{
+    assert(view != nullptr);
+    assert(index != nullptr);
+
+    size_t error = stackViewVerify(view);
+    if (error)
+        return error;
+
+    *index = (size_t) (std::find(std::execution::par,
+                                 view->begin(),
+                                 view->end(),
+                                 value) - view->begin());
+
+    return stackViewVerify(view);
+}
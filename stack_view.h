@@ -0,0 +1,78 @@
+#ifndef STACK_VIEW_H
+#define STACK_VIEW_H
+
+#include "stack.h"
+
+/**
+ * @brief read-only view of live elements of stack, from bottom to top
+ *
+ * Stack is verified once when view is created. Any push, pop or resize
+ * changes stack->generation and makes view invalid, so functions below
+ * check generation instead of verifying stack again. begin() and end()
+ * are raw pointers and can be passed to standard algorithms.
+ */
+struct StackView
+{
+    const Stack *stack = nullptr;
+    const Elem_t *data = nullptr;
+    size_t size = 0;
+    uint32_t generation = 0;
+
+    const Elem_t *begin() const
+    {
+        return data;
+    }
+
+    const Elem_t *end() const
+    {
+        return data + size;
+    }
+};
+
+/**
+ * @brief verifies stack and creates view of it
+ *
+ * @param stack stack to view
+ * @param view view to fill
+ * @return error code
+ */
+size_t stackViewCreate(Stack *stack, StackView *view);
+
+/**
+ * @brief checks that stack wasn't modified since view was created
+ *
+ * @param view view to check
+ * @return STACK_VIEW_INVALID if view is stale
+ */
+size_t stackViewVerify(const StackView *view);
+
+/**
+ * @brief sums elements with parallel reduce
+ *
+ * @param view view of stack
+ * @param sum variable for sum
+ * @return error code
+ */
+size_t stackViewSum(const StackView *view, int64_t *sum);
+
+/**
+ * @brief counts elements equal to value in parallel
+ *
+ * @param view view of stack
+ * @param value value to count
+ * @param count variable for count
+ * @return error code
+ */
+size_t stackViewCount(const StackView *view, Elem_t value, size_t *count);
+
+/**
+ * @brief finds lowest element equal to value in parallel
+ *
+ * @param view view of stack
+ * @param value value to find
+ * @param index variable for index from bottom, view->size if not found
+ * @return error code
+ */
+size_t stackViewFind(const StackView *view, Elem_t value, size_t *index);
+
+#endif
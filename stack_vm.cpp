@@ -0,0 +1,665 @@
+#include "stack_vm.h"
+#include "stack_logs.h"
+#include "stack_watchdog.h"
+
+const size_t VM_MAX_LABEL_LENGTH = 64;
+const size_t VM_MAX_LINE_LENGTH = 256;
+
+struct VmOpcodeInfo
+{
+    const char *name;
+    VmOpcode opcode;
+    bool hasArg;
+    int pops;
+    int pushes;
+};
+
+static const VmOpcodeInfo VM_OPCODES[] = {
+    {"push", VM_PUSH, true,  0, 1},
+    {"pop",  VM_POP,  false, 1, 0},
+    {"dup",  VM_DUP,  false, 1, 2},
+    {"swap", VM_SWAP, false, 2, 2},
+    {"over", VM_OVER, false, 2, 3},
+    {"rot",  VM_ROT,  false, 3, 3},
+    {"add",  VM_ADD,  false, 2, 1},
+    {"sub",  VM_SUB,  false, 2, 1},
+    {"mul",  VM_MUL,  false, 2, 1},
+    {"div",  VM_DIV,  false, 2, 1},
+    {"jmp",  VM_JMP,  true,  0, 0},
+    {"jz",   VM_JZ,   true,  1, 0},
+    {"jnz",  VM_JNZ,  true,  1, 0},
+    {"halt", VM_HALT, false, 0, 0},
+};
+
+struct VmSourceInstruction
+{
+    const VmOpcodeInfo *info;
+    Elem_t arg;
+    char label[VM_MAX_LABEL_LENGTH];
+};
+
+struct VmLabel
+{
+    char name[VM_MAX_LABEL_LENGTH];
+    size_t index;
+};
+
+static const VmOpcodeInfo *vmFindOpcode(const char *name)
+{
+    for (const VmOpcodeInfo &info: VM_OPCODES)
+    {
+        if (strcmp(info.name, name) == 0)
+            return &info;
+    }
+    return nullptr;
+}
+
+static const VmOpcodeInfo *vmFindOpcode(VmOpcode opcode)
+{
+    for (const VmOpcodeInfo &info: VM_OPCODES)
+    {
+        if (info.opcode == opcode)
+            return &info;
+    }
+    return nullptr;
+}
+
+static bool vmIsJump(VmOpcode opcode)
+{
+    return opcode == VM_JMP or opcode == VM_JZ or opcode == VM_JNZ;
+}
+
+static void *vmGrowArray(void *array, size_t *capacity, size_t elemSize)
+{
+    size_t newCapacity = *capacity == 0 ? 16 : *capacity * 2;
+    void *newArray = realloc(array, newCapacity * elemSize);
+    if (newArray != nullptr)
+        *capacity = newCapacity;
+    return newArray;
+}
+
+static size_t vmParse(const char *text,
+                      VmSourceInstruction **source,
+                      size_t *sourceSize,
+                      VmLabel **labels,
+                      size_t *labelsSize)
+{
+    size_t sourceCapacity = 0;
+    size_t labelsCapacity = 0;
+
+    while (*text != '\0')
+    {
+        char line[VM_MAX_LINE_LENGTH] = "";
+        size_t length = strcspn(text, "\n");
+        if (length >= VM_MAX_LINE_LENGTH)
+            return VM_INCORRECT_PROGRAM;
+
+        memcpy(line, text, length);
+        text += length;
+        if (*text == '\n')
+            text++;
+
+        char *comment = strchr(line, ';');
+        if (comment != nullptr)
+            *comment = '\0';
+
+        char name[VM_MAX_LABEL_LENGTH] = "";
+        char arg[VM_MAX_LABEL_LENGTH] = "";
+        char rest[VM_MAX_LABEL_LENGTH] = "";
+        int read = sscanf(line, "%63s %63s %63s", name, arg, rest);
+        if (read <= 0)
+            continue;
+        if (read > 2)
+            return VM_INCORRECT_PROGRAM;
+
+        size_t nameLength = strlen(name);
+        if (name[nameLength - 1] == ':')
+        {
+            if (read != 1 or nameLength == 1)
+                return VM_INCORRECT_PROGRAM;
+
+            if (*labelsSize == labelsCapacity)
+            {
+                VmLabel *newLabels = (VmLabel *) vmGrowArray(
+                    *labels, &labelsCapacity, sizeof(VmLabel));
+                if (newLabels == nullptr)
+                    return CANT_ALLOCATE_MEMORY;
+                *labels = newLabels;
+            }
+            VmLabel *label = *labels + (*labelsSize)++;
+            memcpy(label->name, name, nameLength - 1);
+            label->name[nameLength - 1] = '\0';
+            label->index = *sourceSize;
+            continue;
+        }
+
+        const VmOpcodeInfo *info = vmFindOpcode(name);
+        if (info == nullptr or info->hasArg != (read == 2))
+            return VM_INCORRECT_PROGRAM;
+
+        if (*sourceSize == sourceCapacity)
+        {
+            VmSourceInstruction *newSource =
+                (VmSourceInstruction *) vmGrowArray(
+                    *source, &sourceCapacity, sizeof(VmSourceInstruction));
+            if (newSource == nullptr)
+                return CANT_ALLOCATE_MEMORY;
+            *source = newSource;
+        }
+        VmSourceInstruction *instruction = *source + (*sourceSize)++;
+        *instruction = {info, 0, ""};
+
+        if (vmIsJump(info->opcode))
+        {
+            strcpy(instruction->label, arg);
+        }
+        else if (info->hasArg)
+        {
+            char *end = nullptr;
+            long value = strtol(arg, &end, 0);
+            if (*end != '\0' or value < INT_MIN or value > INT_MAX)
+                return VM_INCORRECT_PROGRAM;
+            instruction->arg = (Elem_t) value;
+        }
+    }
+
+    if (*sourceSize == 0
+        or (*source)[*sourceSize - 1].info->opcode != VM_HALT)
+    {
+        if (*sourceSize == sourceCapacity)
+        {
+            VmSourceInstruction *newSource =
+                (VmSourceInstruction *) vmGrowArray(
+                    *source, &sourceCapacity, sizeof(VmSourceInstruction));
+            if (newSource == nullptr)
+                return CANT_ALLOCATE_MEMORY;
+            *source = newSource;
+        }
+        (*source)[(*sourceSize)++] = {vmFindOpcode("halt"), 0, ""};
+    }
+
+    for (size_t i = 0; i < *labelsSize; i++)
+    {
+        if ((*labels)[i].index >= *sourceSize)
+            (*labels)[i].index = *sourceSize - 1;
+    }
+
+    return STACK_NO_ERRORS;
+}
+
+static size_t vmFindLabel(const VmLabel *labels,
+                          size_t labelsSize,
+                          const char *name)
+{
+    for (size_t i = 0; i < labelsSize; i++)
+    {
+        if (strcmp(labels[i].name, name) == 0)
+            return labels[i].index;
+    }
+    return SIZE_MAX;
+}
+
+static void vmAnalyzeBlock(VmInstruction *block)
+{
+    int depth = 0;
+    int minDepth = 0;
+    int need = 0;
+    int grow = 0;
+    for (VmInstruction *instruction = block + 1;; instruction++)
+    {
+        const VmOpcodeInfo *info = vmFindOpcode(instruction->opcode);
+        if (info == nullptr)
+            break;
+
+        if (info->pops - depth > need)
+            need = info->pops - depth;
+        depth += info->pushes - info->pops;
+        if (depth < minDepth)
+            minDepth = depth;
+        if (depth > grow)
+            grow = depth;
+
+        if (vmIsJump(instruction->opcode) or instruction->opcode == VM_HALT)
+            break;
+    }
+
+    block->arg = need > 1 - minDepth ? need : 1 - minDepth;
+    block->extra = grow;
+}
+
+size_t vmAssemble(const char *text, VmProgram *program)
+{
+    assert(text != nullptr);
+    assert(program != nullptr);
+
+    VmSourceInstruction *source = nullptr;
+    size_t sourceSize = 0;
+    VmLabel *labels = nullptr;
+    size_t labelsSize = 0;
+    bool *leaders = nullptr;
+    size_t *blocks = nullptr;
+
+    size_t error = vmParse(text, &source, &sourceSize, &labels, &labelsSize);
+
+    if (!error)
+    {
+        leaders = (bool *) calloc(sourceSize, sizeof(bool));
+        blocks = (size_t *) calloc(sourceSize, sizeof(size_t));
+        if (leaders == nullptr or blocks == nullptr)
+            error = CANT_ALLOCATE_MEMORY;
+    }
+
+    size_t codeSize = sourceSize;
+    for (size_t i = 0; !error and i < sourceSize; i++)
+    {
+        VmOpcode opcode = source[i].info->opcode;
+        if (i == 0)
+            leaders[i] = true;
+        if ((vmIsJump(opcode) or opcode == VM_HALT) and i + 1 < sourceSize)
+            leaders[i + 1] = true;
+        if (vmIsJump(opcode))
+        {
+            size_t target = vmFindLabel(labels, labelsSize, source[i].label);
+            if (target == SIZE_MAX)
+                error = VM_INCORRECT_PROGRAM;
+            else
+                leaders[target] = true;
+        }
+    }
+
+    for (size_t i = 0; !error and i < sourceSize; i++)
+    {
+        if (leaders[i])
+            codeSize++;
+    }
+
+    VmInstruction *code = nullptr;
+    if (!error)
+    {
+        code = (VmInstruction *) calloc(codeSize, sizeof(VmInstruction));
+        if (code == nullptr)
+            error = CANT_ALLOCATE_MEMORY;
+    }
+
+    size_t pc = 0;
+    for (size_t i = 0; !error and i < sourceSize; i++)
+    {
+        if (leaders[i])
+        {
+            blocks[i] = pc;
+            code[pc++] = {VM_BLOCK, 0, 0};
+        }
+        code[pc++] = {source[i].info->opcode, source[i].arg, 0};
+    }
+
+    for (size_t i = 0, index = 0; !error and i < sourceSize; i++)
+    {
+        index += leaders[i] ? 2 : 1;
+        if (!vmIsJump(source[i].info->opcode))
+            continue;
+
+        size_t target = vmFindLabel(labels, labelsSize, source[i].label);
+        if (blocks[target] > INT_MAX)
+            error = VM_INCORRECT_PROGRAM;
+        else
+            code[index - 1].arg = (Elem_t) blocks[target];
+    }
+
+    for (size_t i = 0; !error and i < codeSize; i++)
+    {
+        if (code[i].opcode == VM_BLOCK)
+            vmAnalyzeBlock(code + i);
+    }
+
+    free(source);
+    free(labels);
+    free(leaders);
+    free(blocks);
+
+    if (error)
+    {
+        free(code);
+        return error;
+    }
+
+    program->code = code;
+    program->size = codeSize;
+    return error;
+}
+
+void vmProgramDtor(VmProgram *program)
+{
+    assert(program != nullptr);
+
+    free(program->code);
+    program->code = nullptr;
+    program->size = 0;
+}
+
+static Elem_t vmAdd(Elem_t a, Elem_t b)
+{
+    return (Elem_t) ((unsigned) a + (unsigned) b);
+}
+
+static Elem_t vmSub(Elem_t a, Elem_t b)
+{
+    return (Elem_t) ((unsigned) a - (unsigned) b);
+}
+
+static Elem_t vmMul(Elem_t a, Elem_t b)
+{
+    return (Elem_t) ((unsigned) a * (unsigned) b);
+}
+
+static Elem_t vmDiv(Elem_t a, Elem_t b)
+{
+    if (b == -1)
+        return vmSub(0, a);
+    return a / b;
+}
+
+static size_t vmStepChecked(Stack *stack,
+                            const VmInstruction *code,
+                            const VmInstruction **ip)
+{
+    const VmInstruction *instruction = *ip;
+    size_t error = STACK_NO_ERRORS;
+    Elem_t a = 0;
+    Elem_t b = 0;
+    Elem_t c = 0;
+
+    *ip = instruction + 1;
+    switch (instruction->opcode)
+    {
+        case VM_BLOCK:
+            break;
+        case VM_PUSH:
+            error = stackPush(stack, instruction->arg);
+            break;
+        case VM_POP:
+            error = stackPop(stack, &a);
+            break;
+        case VM_DUP:
+            error = stackPop(stack, &a);
+            if (!error)
+                error = stackPush(stack, a);
+            if (!error)
+                error = stackPush(stack, a);
+            break;
+        case VM_SWAP:
+            error = stackPop(stack, &b);
+            if (!error)
+                error = stackPop(stack, &a);
+            if (!error)
+                error = stackPush(stack, b);
+            if (!error)
+                error = stackPush(stack, a);
+            break;
+        case VM_OVER:
+            error = stackPop(stack, &b);
+            if (!error)
+                error = stackPop(stack, &a);
+            if (!error)
+                error = stackPush(stack, a);
+            if (!error)
+                error = stackPush(stack, b);
+            if (!error)
+                error = stackPush(stack, a);
+            break;
+        case VM_ROT:
+            error = stackPop(stack, &c);
+            if (!error)
+                error = stackPop(stack, &b);
+            if (!error)
+                error = stackPop(stack, &a);
+            if (!error)
+                error = stackPush(stack, b);
+            if (!error)
+                error = stackPush(stack, c);
+            if (!error)
+                error = stackPush(stack, a);
+            break;
+        case VM_ADD:
+        case VM_SUB:
+        case VM_MUL:
+        case VM_DIV:
+            error = stackPop(stack, &b);
+            if (!error)
+                error = stackPop(stack, &a);
+            if (error)
+                break;
+            if (instruction->opcode == VM_DIV and b == 0)
+            {
+                error = stackPush(stack, a);
+                if (!error)
+                    error = stackPush(stack, b);
+                error |= VM_DIVISION_BY_ZERO;
+                break;
+            }
+            if (instruction->opcode == VM_ADD)
+                error = stackPush(stack, vmAdd(a, b));
+            else if (instruction->opcode == VM_SUB)
+                error = stackPush(stack, vmSub(a, b));
+            else if (instruction->opcode == VM_MUL)
+                error = stackPush(stack, vmMul(a, b));
+            else
+                error = stackPush(stack, vmDiv(a, b));
+            break;
+        case VM_JMP:
+            *ip = code + instruction->arg;
+            break;
+        case VM_JZ:
+        case VM_JNZ:
+            error = stackPop(stack, &a);
+            if (!error and (a == 0) == (instruction->opcode == VM_JZ))
+                *ip = code + instruction->arg;
+            break;
+        case VM_HALT:
+            *ip = nullptr;
+            break;
+        case VM_OPCODES_COUNT:
+        default:
+            error = VM_INCORRECT_PROGRAM;
+            break;
+    }
+
+    return error;
+}
+
+size_t vmExecuteNaive(const VmProgram *program,
+                      Stack *stack,
+                      size_t *executed)
+{
+    assert(program != nullptr);
+    assert(stack != nullptr);
+
+    size_t error = STACK_NO_ERRORS;
+    size_t count = 0;
+    const VmInstruction *ip = program->code;
+
+    while (!error and ip != nullptr)
+    {
+        if (ip->opcode != VM_BLOCK)
+            count++;
+        error = vmStepChecked(stack, program->code, &ip);
+    }
+
+    if (executed != nullptr)
+        *executed = count;
+    return error;
+}
+
+#define VM_DISPATCH()                                                  \
+{                                                                      \
+    goto *VM_LABELS[ip->opcode];                                       \
+}
+
+#define VM_NEXT()                                                      \
+{                                                                      \
+    count++;                                                           \
+    ip++;                                                              \
+    VM_DISPATCH()                                                      \
+}
+
+size_t vmExecute(const VmProgram *program, Stack *stack, size_t *executed)
+{
+    assert(program != nullptr);
+    assert(stack != nullptr);
+
+    static const void *const VM_LABELS[VM_OPCODES_COUNT] = {
+        &&vm_block, &&vm_push, &&vm_pop, &&vm_dup, &&vm_swap,
+        &&vm_over, &&vm_rot, &&vm_add, &&vm_sub, &&vm_mul,
+        &&vm_div, &&vm_jmp, &&vm_jz, &&vm_jnz, &&vm_halt,
+    };
+
+    const VmInstruction *code = program->code;
+    const VmInstruction *ip = code;
+    size_t error = STACK_NO_ERRORS;
+    size_t count = 0;
+    bool cached = false;
+#if (WatchdogProtection)
+    bool writeOpened = false;
+#endif
+    Elem_t *sp = nullptr;
+    Elem_t tos = 0;
+    Elem_t a = 0;
+
+    goto vm_block;
+
+vm_block:
+    if (cached)
+    {
+        *sp = tos;
+        cached = false;
+        error = stackSyncData(stack, (size_t) (sp - stack->data) + 1);
+#if (WatchdogProtection)
+        stackWriteEnd(stack, writeOpened);
+#endif
+#if (AsanProtection)
+        if (!error)
+#else
+        if (!error and (size_t) stack->size + (size_t) ip->extra
+            > stack->capacity)
+#endif
+            error = stackReserve(stack, stack->size + (size_t) ip->extra);
+    }
+    else
+        error = stackReserve(stack, stack->size + (size_t) ip->extra);
+
+    if (error)
+        goto vm_exit;
+
+    if (stack->size < (size_t) ip->arg)
+    {
+        ip++;
+        while (ip != nullptr and ip->opcode != VM_BLOCK)
+        {
+            count++;
+            error = vmStepChecked(stack, code, &ip);
+            if (error)
+                goto vm_exit;
+        }
+        if (ip == nullptr)
+            goto vm_exit;
+        goto vm_block;
+    }
+
+    cached = true;
+#if (WatchdogProtection)
+    writeOpened = stackWriteBegin(stack);
+#endif
+    sp = stack->data + stack->size - 1;
+    tos = *sp;
+    ip++;
+    VM_DISPATCH()
+
+vm_push:
+    *sp++ = tos;
+    tos = ip->arg;
+    VM_NEXT()
+
+vm_pop:
+    tos = *--sp;
+    VM_NEXT()
+
+vm_dup:
+    *sp++ = tos;
+    VM_NEXT()
+
+vm_swap:
+    a = sp[-1];
+    sp[-1] = tos;
+    tos = a;
+    VM_NEXT()
+
+vm_over:
+    *sp++ = tos;
+    tos = sp[-2];
+    VM_NEXT()
+
+vm_rot:
+    a = sp[-2];
+    sp[-2] = sp[-1];
+    sp[-1] = tos;
+    tos = a;
+    VM_NEXT()
+
+vm_add:
+    sp--;
+    tos = vmAdd(*sp, tos);
+    VM_NEXT()
+
+vm_sub:
+    sp--;
+    tos = vmSub(*sp, tos);
+    VM_NEXT()
+
+vm_mul:
+    sp--;
+    tos = vmMul(*sp, tos);
+    VM_NEXT()
+
+vm_div:
+    if (tos == 0)
+    {
+        error = VM_DIVISION_BY_ZERO;
+        goto vm_sync;
+    }
+    sp--;
+    tos = vmDiv(*sp, tos);
+    VM_NEXT()
+
+vm_jmp:
+    count++;
+    ip = code + ip->arg;
+    goto vm_block;
+
+vm_jz:
+    count++;
+    a = tos;
+    tos = *--sp;
+    ip = a == 0 ? code + ip->arg : ip + 1;
+    goto vm_block;
+
+vm_jnz:
+    count++;
+    a = tos;
+    tos = *--sp;
+    ip = a != 0 ? code + ip->arg : ip + 1;
+    goto vm_block;
+
+vm_halt:
+    count++;
+
+vm_sync:
+    *sp = tos;
+    error |= stackSyncData(stack, (size_t) (sp - stack->data) + 1);
+#if (WatchdogProtection)
+    stackWriteEnd(stack, writeOpened);
+#endif
+
+vm_exit:
+    if (executed != nullptr)
+        *executed = count;
+    return error;
+}
@@ -0,0 +1,91 @@
+#ifndef STACK_VM_H
+#define STACK_VM_H
+
+#include "stack.h"
+
+enum VmOpcode
+{
+    VM_BLOCK = 0,
+    VM_PUSH  = 1,
+    VM_POP   = 2,
+    VM_DUP   = 3,
+    VM_SWAP  = 4,
+    VM_OVER  = 5,
+    VM_ROT   = 6,
+    VM_ADD   = 7,
+    VM_SUB   = 8,
+    VM_MUL   = 9,
+    VM_DIV   = 10,
+    VM_JMP   = 11,
+    VM_JZ    = 12,
+    VM_JNZ   = 13,
+    VM_HALT  = 14,
+    VM_OPCODES_COUNT,
+};
+
+/**
+ * @brief one instruction of bytecode
+ *
+ * For VM_BLOCK arg is number of elements needed to run block on fast path
+ * and extra is max growth of stack inside block. For jumps arg is index of
+ * target VM_BLOCK.
+ */
+struct VmInstruction
+{
+    VmOpcode opcode = VM_HALT;
+    Elem_t arg = 0;
+    Elem_t extra = 0;
+};
+
+struct VmProgram
+{
+    VmInstruction *code = nullptr;
+    size_t size = 0;
+};
+
+/**
+ * @brief assembles program from text
+ *
+ * One instruction per line, labels are written as 'name:', comments
+ * start with ';'. Assembler splits program into blocks and puts VM_BLOCK
+ * at start of each one.
+ *
+ * @param text text of program
+ * @param program program to fill
+ * @return error code
+ */
+size_t vmAssemble(const char *text, VmProgram *program);
+
+/**
+ * @brief frees program
+ *
+ * @param program program to free
+ */
+void vmProgramDtor(VmProgram *program);
+
+/**
+ * @brief runs program using stack as operand stack
+ *
+ * Top of stack is cached in register and stack->data is accessed
+ * directly inside blocks, checked stack API is called only at VM_BLOCK.
+ *
+ * @param program program to run
+ * @param stack operand stack
+ * @param executed number of executed instructions, can be nullptr
+ * @return error code
+ */
+size_t vmExecute(const VmProgram *program, Stack *stack, size_t *executed);
+
+/**
+ * @brief runs program calling stackPush and stackPop on every instruction
+ *
+ * @param program program to run
+ * @param stack operand stack
+ * @param executed number of executed instructions, can be nullptr
+ * @return error code
+ */
+size_t vmExecuteNaive(const VmProgram *program,
+                      Stack *stack,
+                      size_t *executed);
+
+#endif
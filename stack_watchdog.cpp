@@ -0,0 +1,200 @@
+#include "stack_watchdog.h"
+
+#if (WatchdogProtection)
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <pthread.h>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "stack_verification.h"
+#include "stack_logs.h"
+
+static std::mutex STACK_REGISTRY_MUTEX;
+static std::unordered_set<Stack *> STACK_REGISTRY;
+static std::atomic<Stack *> STACK_WATCHDOG_READING(nullptr);
+
+static std::mutex STACK_WATCHDOG_MUTEX;
+static std::condition_variable STACK_WATCHDOG_WAKE;
+static std::thread STACK_WATCHDOG_THREAD;
+static bool STACK_WATCHDOG_RUNNING = false;
+
+static void stackWatchdogForkPrepare()
+{
+    STACK_WATCHDOG_MUTEX.lock();
+    STACK_REGISTRY_MUTEX.lock();
+}
+
+static void stackWatchdogForkParent()
+{
+    STACK_REGISTRY_MUTEX.unlock();
+    STACK_WATCHDOG_MUTEX.unlock();
+}
+
+/**
+ * @brief stops watchdog in forked child, fork doesn't copy its thread
+ */
+static void stackWatchdogForkChild()
+{
+    // handle of thread which doesn't exist is leaked, join would hang
+    if (STACK_WATCHDOG_THREAD.joinable())
+        new std::thread(std::move(STACK_WATCHDOG_THREAD));
+    STACK_WATCHDOG_RUNNING = false;
+    STACK_WATCHDOG_READING.store(nullptr);
+
+    stackWatchdogForkParent();
+}
+
+static void stackWatchdogAtFork()
+{
+    static const int registered = pthread_atfork(stackWatchdogForkPrepare,
+                                                 stackWatchdogForkParent,
+                                                 stackWatchdogForkChild);
+    (void) registered;
+}
+
+void stackWatchdogRegister(Stack *stack)
+{
+    assert(stack != nullptr);
+
+    stackWatchdogAtFork();
+
+    std::lock_guard<std::mutex> lock(STACK_REGISTRY_MUTEX);
+    STACK_REGISTRY.insert(stack);
+}
+
+void stackWatchdogUnregister(Stack *stack)
+{
+    assert(stack != nullptr);
+
+    {
+        std::lock_guard<std::mutex> lock(STACK_REGISTRY_MUTEX);
+        STACK_REGISTRY.erase(stack);
+    }
+    stackWatchdogWait(stack);
+}
+
+void stackWatchdogWait(Stack *stack)
+{
+    while (STACK_WATCHDOG_READING.load() == stack)
+        std::this_thread::yield();
+}
+
+bool stackWriteBegin(Stack *stack)
+{
+    assert(stack != nullptr);
+
+    uint32_t seq = __atomic_load_n(&stack->seq, __ATOMIC_RELAXED);
+    if (seq & 1)
+        return false;
+
+    __atomic_store_n(&stack->seq, seq + 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return true;
+}
+
+void stackWriteEnd(Stack *stack, bool opened)
+{
+    assert(stack != nullptr);
+
+    if (!opened)
+        return;
+
+    uint32_t seq = __atomic_load_n(&stack->seq, __ATOMIC_RELAXED);
+    __atomic_store_n(&stack->seq, seq + 1, __ATOMIC_RELEASE);
+}
+
+static bool stackWatchdogCheck(Stack *stack)
+{
+    uint32_t seq = __atomic_load_n(&stack->seq, __ATOMIC_ACQUIRE);
+    if (seq & 1)
+        return true;
+
+    Stack snapshot = {};
+    memcpy((void *) &snapshot, (const void *) stack, sizeof(Stack));
+    snapshot.seq = 0;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+    size_t error = stackVerifier(&snapshot);
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&stack->seq, __ATOMIC_RELAXED) != seq or !error)
+        return true;
+
+    StackInfo info = {__LINE__, __FILE__, __PRETTY_FUNCTION__, "watchdog"};
+    logStack(STACK_LOG_FILE,
+             "Watchdog found broken stack [%p], dump of its snapshot:\n",
+             stack);
+    stackDump(&snapshot, &info, error, printElem_t);
+    return false;
+}
+
+size_t stackWatchdogCheckAll()
+{
+    std::vector<Stack *> stacks;
+    {
+        std::lock_guard<std::mutex> lock(STACK_REGISTRY_MUTEX);
+        stacks.assign(STACK_REGISTRY.begin(), STACK_REGISTRY.end());
+    }
+
+    size_t broken = 0;
+    for (Stack *stack: stacks)
+    {
+        {
+            std::lock_guard<std::mutex> lock(STACK_REGISTRY_MUTEX);
+            if (STACK_REGISTRY.count(stack) == 0)
+                continue;
+            STACK_WATCHDOG_READING.store(stack);
+        }
+
+        if (!stackWatchdogCheck(stack))
+            broken++;
+
+        STACK_WATCHDOG_READING.store(nullptr);
+    }
+
+    return broken;
+}
+
+static void stackWatchdogLoop(unsigned periodMs)
+{
+    std::unique_lock<std::mutex> lock(STACK_WATCHDOG_MUTEX);
+    while (STACK_WATCHDOG_RUNNING)
+    {
+        lock.unlock();
+        stackWatchdogCheckAll();
+        lock.lock();
+
+        STACK_WATCHDOG_WAKE.wait_for(lock,
+                                     std::chrono::milliseconds(periodMs),
+                                     [] { return !STACK_WATCHDOG_RUNNING; });
+    }
+}
+
+void stackWatchdogStart(unsigned periodMs)
+{
+    stackWatchdogAtFork();
+
+    std::lock_guard<std::mutex> lock(STACK_WATCHDOG_MUTEX);
+    if (STACK_WATCHDOG_RUNNING)
+        return;
+
+    STACK_WATCHDOG_RUNNING = true;
+    STACK_WATCHDOG_THREAD = std::thread(stackWatchdogLoop, periodMs);
+}
+
+void stackWatchdogStop()
+{
+    {
+        std::lock_guard<std::mutex> lock(STACK_WATCHDOG_MUTEX);
+        if (!STACK_WATCHDOG_RUNNING)
+            return;
+        STACK_WATCHDOG_RUNNING = false;
+    }
+
+    STACK_WATCHDOG_WAKE.notify_all();
+    STACK_WATCHDOG_THREAD.join();
+}
+#endif
@@ -0,0 +1,95 @@
+#ifndef STACK_WATCHDOG_H
+#define STACK_WATCHDOG_H
+
+#include "stack.h"
+
+#if (WatchdogProtection)
+/**
+ * @brief adds stack to registry of live stacks
+ *
+ * @param stack stack to register
+ */
+void stackWatchdogRegister(Stack *stack);
+
+/**
+ * @brief removes stack from registry and waits until watchdog stops
+ * reading it
+ *
+ * @param stack stack to unregister
+ */
+void stackWatchdogUnregister(Stack *stack);
+
+/**
+ * @brief waits until watchdog stops reading stack, called before
+ * freeing or reallocating stack data
+ *
+ * @param stack stack to wait for
+ */
+void stackWatchdogWait(Stack *stack);
+
+/**
+ * @brief marks stack as being changed, nested calls are allowed
+ *
+ * @param stack stack to change
+ * @return true if this call started change and has to end it
+ */
+bool stackWriteBegin(Stack *stack);
+
+/**
+ * @brief marks end of stack change
+ *
+ * @param stack changed stack
+ * @param opened value returned by stackWriteBegin
+ */
+void stackWriteEnd(Stack *stack, bool opened);
+
+/**
+ * @brief verifies all registered stacks once, dumps broken ones
+ *
+ * @return number of stacks with errors
+ */
+size_t stackWatchdogCheckAll();
+
+/**
+ * @brief starts background thread which verifies all registered stacks
+ *
+ * @param periodMs pause between checks in milliseconds
+ */
+void stackWatchdogStart(unsigned periodMs);
+
+/**
+ * @brief stops background thread
+ */
+void stackWatchdogStop();
+
+/**
+ * @brief marks stack as being changed until end of scope
+ */
+struct StackWriteGuard
+{
+    Stack *stack;
+    bool opened;
+
+    explicit StackWriteGuard(Stack *changedStack)
+        : stack(changedStack), opened(stackWriteBegin(changedStack))
+    {
+    }
+
+    ~StackWriteGuard()
+    {
+        stackWriteEnd(stack, opened);
+    }
+
+    StackWriteGuard(const StackWriteGuard &) = delete;
+    StackWriteGuard &operator=(const StackWriteGuard &) = delete;
+};
+
+#define STACK_WRITE_GUARD_NAME_(line) stackWriteGuard_##line
+#define STACK_WRITE_GUARD_NAME(line) STACK_WRITE_GUARD_NAME_(line)
+#define STACK_WRITE_GUARD(stack)                                       \
+    StackWriteGuard STACK_WRITE_GUARD_NAME(__LINE__)((stack));
+#else
+#define STACK_WRITE_GUARD(stack)
+#endif
+
+#endif
@@ -1,10 +1,94 @@
 #include "config.h"
 #include "stack.h"
+#include "stack_records.h"
+#include "stack_vm.h"
+#include "stack_aggregate.h"
+#include "stack_watchdog.h"
+#include "stack_hash.h"
+#include "stack_verification.h"
+#include "stack_logs.h"
+#include "stack_trace.h"
+#include "stack_fixed.h"
+#include "stack_tiered.h"
+#include "stack_view.h"
+#include "stack_ring.h"
+#include "stack_budget.h"
+#include "stack_simd.h"
+#include "stack_batch.h"
+
+#include <algorithm>
+#include <numeric>
+
+#if (WatchdogProtection)
+#include <atomic>
+#include <thread>
+#endif
+
+#include <unistd.h>
+
+#if (AsanProtection)
+#include <sanitizer/asan_interface.h>
+#include <sys/wait.h>
+
+/// tests 2 and 4 break stacks on purpose, so they can't be freed
+extern "C" const char *__asan_default_options()
+{
+    return "detect_leaks=0";
+}
+#endif
 
 bool test_1();
 bool test_2();
 bool test_3();
 bool test_4();
+bool test_5();
+bool test_6();
+bool test_7();
+bool test_8();
+bool test_9();
+bool test_10();
+bool test_11();
+bool test_12();
+bool test_13();
+bool test_14();
+bool test_15();
+bool test_16();
+bool test_17();
+bool test_18();
+bool test_19();
+bool test_20();
+bool test_21();
+bool test_22();
+bool test_23();
+bool test_24();
+bool test_25();
+bool test_26();
+bool test_27();
+bool test_28();
+bool test_29();
+
+constexpr Elem_t fixedStackConstexprSum()
+{
+    StaticStack<8> stack = {};
+    size_t error = staticStackCtor(&stack);
+    for (Elem_t i = 1; i <= 8; i++)
+        error |= fixedStackPush(&stack.stack, i);
+    if (fixedStackPush(&stack.stack, 9) != STACK_OVERFLOW)
+        return -1;
+
+    Elem_t sum = 0;
+    for (int i = 0; i < 8; i++)
+    {
+        Elem_t value = 0;
+        error |= fixedStackPop(&stack.stack, &value);
+        sum += value;
+    }
+    error |= fixedStackDtor(&stack.stack);
+    return error ? -1 : sum;
+}
+
+static_assert(fixedStackConstexprSum() == 36,
+              "Fixed stack must work in constant expressions");
 
 bool test_1()
 {
@@ -99,10 +183,1223 @@ bool test_4()
     return true;
 }
 
+bool test_5()
+{
+    Stack stacks[2] = {};
+
+    size_t error = STACK_NO_ERRORS;
+    for (Stack &stack: stacks)
+    {
+        stackCtor(&stack, 0, &error)
+        error |= stackPush(&stack, 1);
+    }
+    if (error)
+        return false;
+
+    const StackInfo *info = stackInfoGet(stacks[0].infoId);
+    bool correct = stacks[0].infoId != STACK_UNKNOWN_INFO_ID
+        && stacks[0].infoId == stacks[1].infoId
+        && strcmp(info->name, "&stack") == 0
+        && strcmp(info->initFile, __FILE__) == 0
+        && stackInfoGet(STACK_MAX_CALLSITES) == stackInfoGet(STACK_UNKNOWN_INFO_ID);
+
+    for (Stack &stack: stacks)
+        error |= stackDtor(&stack);
+
+    return correct && !error;
+}
+
+bool test_6()
+{
+    RecordStack stack = {};
+
+    size_t error = STACK_NO_ERRORS;
+    recordStackCtor(&stack, 0, &error)
+
+    const char *strings[] = {"a", "", "record", "longer record with tail"};
+    for (RecordTag tag = 0; tag < 4; tag++)
+    {
+        error |= recordStackPush(&stack,
+                                 strings[tag],
+                                 strlen(strings[tag]),
+                                 tag);
+    }
+    if (error)
+        return false;
+
+    RecordView view = {};
+    error = recordStackPeek(&stack, &view);
+    bool correct = !error && view.tag == 3 && stack.count == 4;
+
+    for (RecordTag tag = 4; tag > 0; tag--)
+    {
+        error |= recordStackPop(&stack, &view);
+        correct = correct
+            && ((uintptr_t) view.data % RECORD_ALIGNMENT) == 0
+            && view.tag == tag - 1
+            && view.length == strlen(strings[tag - 1])
+            && memcmp(view.data, strings[tag - 1], view.length) == 0;
+    }
+    correct = correct && !error
+        && recordStackPop(&stack, &view) == STACK_IS_EMPTY;
+
+    Elem_t values[] = {1, 2, 3};
+    error |= recordStackPush(&stack, values, sizeof(values), 42);
+    error |= recordStackPush(&stack, values, sizeof(values[0]), 43);
+    error |= recordStackShrinkToFit(&stack);
+    correct = correct && !error && stack.size == stack.capacity;
+
+    RecordFrame *frame = (RecordFrame *) (stack.data + 2 * RECORD_ALIGNMENT);
+    frame->length = 0;
+    correct = correct
+        && (recordStackVerifier(&stack) & STACK_RECORD_FRAME_CORRUPTED);
+    frame->length = sizeof(values);
+    error = recordStackDtor(&stack);
+
+    return correct && !error;
+}
+
+bool test_7()
+{
+    const char *fibonacci =
+        "    push 0\n"
+        "    push 1\n"
+        "    push 10 ; counter\n"
+        "loop:\n"
+        "    rot\n"
+        "    rot\n"
+        "    swap\n"
+        "    over\n"
+        "    add\n"
+        "    rot\n"
+        "    push 1\n"
+        "    sub\n"
+        "    dup\n"
+        "    jnz loop\n"
+        "    pop\n"
+        "    halt\n";
+
+    VmProgram program = {};
+    size_t error = vmAssemble(fibonacci, &program);
+    if (error)
+        return false;
+
+    Stack fast = {};
+    Stack naive = {};
+    stackCtor(&fast, 0, &error)
+    stackCtor(&naive, 0, &error)
+
+    size_t fastExecuted = 0;
+    size_t naiveExecuted = 0;
+    error |= vmExecute(&program, &fast, &fastExecuted);
+    error |= vmExecuteNaive(&program, &naive, &naiveExecuted);
+
+    Elem_t fastTop = 0;
+    Elem_t naiveTop = 0;
+    error |= stackPop(&fast, &fastTop);
+    error |= stackPop(&naive, &naiveTop);
+    bool correct = !error
+        && fastTop == 89 && naiveTop == 89
+        && fastExecuted == naiveExecuted
+        && fast.size == 1 && naive.size == 1
+        && fast.data[0] == 55 && naive.data[0] == 55;
+
+    vmProgramDtor(&program);
+    correct = correct
+        && vmAssemble("push 1\npush 0\ndiv\n", &program) == 0
+        && vmExecute(&program, &fast, nullptr) == VM_DIVISION_BY_ZERO
+        && vmExecuteNaive(&program, &naive, nullptr) == VM_DIVISION_BY_ZERO
+        && fast.size == 3 && naive.size == 3;
+
+    vmProgramDtor(&program);
+    correct = correct
+        && vmAssemble("jmp nowhere\n", &program) == VM_INCORRECT_PROGRAM
+        && vmAssemble("push\n", &program) == VM_INCORRECT_PROGRAM
+        && vmAssemble("pop\npop\npop\npop\n", &program) == 0
+        && vmExecute(&program, &fast, nullptr) == STACK_IS_EMPTY
+        && fast.size == 0;
+
+    vmProgramDtor(&program);
+    error = stackDtor(&fast);
+    error |= stackDtor(&naive);
+
+    return correct && !error;
+}
+
+bool test_8()
+{
+    AggregateStack stack = {};
+
+    size_t error = STACK_NO_ERRORS;
+    aggregateStackCtor(&stack, 0, &error)
+
+    Elem_t values[] = {5, 3, 8, 3, 1, 9, 2};
+    error |= aggregateStackPush(&stack, values[0]);
+    error |= aggregateStackPushMany(&stack, values + 1, 6);
+
+    Elem_t min = 0;
+    Elem_t max = 0;
+    int64_t sum = 0;
+    error |= stackMin(&stack, &min);
+    error |= stackMax(&stack, &max);
+    error |= stackSum(&stack, &sum);
+    bool correct = !error && min == 1 && max == 9 && sum == 31;
+
+    Elem_t popped[3] = {};
+    error |= aggregateStackPopMany(&stack, popped, 3);
+    error |= stackMin(&stack, &min);
+    error |= stackMax(&stack, &max);
+    error |= stackSum(&stack, &sum);
+    correct = correct && !error && popped[0] == 2 && popped[2] == 1
+        && min == 3 && max == 8 && sum == 19;
+
+    Elem_t value = 0;
+    error |= aggregateStackPop(&stack, &value);
+    error |= aggregateStackPop(&stack, &value);
+    error |= stackMin(&stack, &min);
+    error |= stackMax(&stack, &max);
+    correct = correct && !error && value == 8 && min == 3 && max == 5;
+
+#if (HashProtection)
+    stack.sum++;
+    correct = correct
+        && (aggregateStackVerifier(&stack) & STACK_INCORRECT_HASH);
+    stack.sum--;
+#endif
+
+    error = aggregateStackDtor(&stack);
+
+    return correct && !error;
+}
+
+bool test_9()
+{
+#if (WatchdogProtection)
+    Stack stack = {};
+
+    size_t error = STACK_NO_ERRORS;
+    stackCtor(&stack, 0, &error)
+    error |= stackPush(&stack, 1);
+
+    bool correct = !error && stackWatchdogCheckAll() == 0;
+    stack.data[0] = 2;
+    correct = correct && stackWatchdogCheckAll() == 1;
+    stack.data[0] = 1;
+
+    std::atomic<bool> running(true);
+    std::atomic<size_t> broken(0);
+    std::thread checker([&running, &broken]()
+                        {
+                            while (running.load())
+                                broken += stackWatchdogCheckAll();
+                        });
+
+    stackWatchdogStart(1);
+    for (int i = 0; i < 5000; i++)
+    {
+        Elem_t value = 0;
+        error |= stackPush(&stack, i);
+        if (i % 3 == 0)
+            error |= stackPop(&stack, &value);
+    }
+    stackWatchdogStop();
+
+    running = false;
+    checker.join();
+
+    error |= stackDtor(&stack);
+    return correct && !error && broken == 0 && stackWatchdogCheckAll() == 0;
+#else
+    return true;
+#endif
+}
+
+bool test_10()
+{
+#if (HashProtection)
+    StackHashConfig defaultConfig = stackHashGetConfig();
+    StackHashConfig config = {};
+    config.threads = 4;
+    config.threshold = 1024;
+    config.chunkSize = 256;
+    stackHashConfigure(config);
+
+    Stack stack = {};
+    size_t error = STACK_NO_ERRORS;
+    stackCtor(&stack, 0, &error)
+
+    Elem_t values[1000] = {};
+    for (int i = 0; i < 1000; i++)
+        values[i] = i;
+    error |= stackPushMany(&stack, values, 1000);
+
+    size_t size = stack.capacity * sizeof(Elem_t);
+    size_t parallel = hashDataChunked(stack.data, size, nullptr);
+    config.threads = 1;
+    stackHashConfigure(config);
+    bool correct = !error && stackHashIsChunked(size)
+        && parallel == hashDataChunked(stack.data, size, nullptr)
+        && stackFindCorruptedChunk(&stack) == STACK_NO_CORRUPTED_CHUNK;
+
+    stack.data[700] = -1;
+    correct = correct
+        && (stackVerifier(&stack) & STACK_DATA_INCORRECT_HASH)
+        && stackFindCorruptedChunk(&stack) == 700 * sizeof(Elem_t) / 256;
+    stack.data[700] = 700;
+
+    error = stackDtor(&stack);
+    stackHashConfigure(defaultConfig);
+
+    return correct && !error;
+#else
+    return true;
+#endif
+}
+
+bool test_11()
+{
+#if (AsanProtection)
+    Stack stack = {};
+    size_t error = STACK_NO_ERRORS;
+    stackCtor(&stack, 0, &error)
+
+    for (int i = 0; i < 3; i++)
+        error |= stackPush(&stack, i);
+
+    bool correct = !error && stack.capacity == 4
+        && !__asan_address_is_poisoned(stack.data + 2)
+        && __asan_address_is_poisoned(stack.data + 3);
+
+    Elem_t value = 0;
+    error |= stackPop(&stack, &value);
+    correct = correct && value == 2
+        && __asan_address_is_poisoned(stack.data + 2);
+
+    error |= stackReserve(&stack, 4);
+    correct = correct && !__asan_address_is_poisoned(stack.data + 3);
+    error |= stackSyncData(&stack, stack.size);
+    correct = correct && __asan_address_is_poisoned(stack.data + 2);
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        freopen("/dev/null", "w", stderr);
+        volatile Elem_t dead = stack.data[stack.size];
+        (void) dead;
+        _exit(0);
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    correct = correct && !(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    error |= stackDtor(&stack);
+    return correct && !error;
+#else
+    return true;
+#endif
+}
+
+bool test_12()
+{
+    StackDumpLimits limits = {};
+    limits.fullPerSecond = 4;
+    limits.linesPerSecond = 8;
+    stackDumpConfigure(limits);
+
+    FILE *logFile = tmpfile();
+    if (logFile == nullptr)
+        return false;
+    STACK_LOG_FILE = logFile;
+
+    Stack stack = {};
+    size_t error = STACK_NO_ERRORS;
+    stackCtor(&stack, 0, &error)
+    error |= stackDtor(&stack);
+
+    for (int i = 0; i < 1000; i++)
+    {
+        Elem_t value = 0;
+        error = stackPop(&stack, &value);
+    }
+
+    StackDumpStats stats = stackDumpGetStats();
+    long beforeSummary = ftell(logFile);
+    stackDumpSummary();
+    bool correct = error == STACK_NOT_ALIVE && stats.full == 1
+        && stats.lines <= 8
+        && stats.full + stats.lines + stats.suppressed == 1000
+        && ftell(logFile) > beforeSummary;
+
+    STACK_LOG_FILE = stderr;
+    fclose(logFile);
+    stackDumpConfigure({});
+
+    return correct;
+}
+
+bool test_13()
+{
+#if (TraceRecording)
+    const char *filename = "stack_trace_test.bin";
+    size_t error = stackTraceStart(filename);
+    if (error)
+        return false;
+
+    Stack stack = {};
+    stackCtor(&stack, 0, &error)
+    for (int i = 0; i < 100; i++)
+        error |= stackPush(&stack, i);
+    for (int i = 0; i < 50; i++)
+    {
+        Elem_t value = 0;
+        error |= stackPop(&stack, &value);
+    }
+    error |= stackDtor(&stack);
+    stackTraceStop();
+
+    StackTraceRecord *records = nullptr;
+    size_t count = 0;
+    error |= stackTraceRead(filename, &records, &count);
+    remove(filename);
+
+    size_t ops[TRACE_OPS_COUNT] = {};
+    bool correct = !error && count > 0
+        && records[0].op == TRACE_CTOR
+        && records[count - 1].op == TRACE_DTOR;
+    for (size_t i = 0; i < count; i++)
+    {
+        ops[records[i].op]++;
+        correct = correct
+            && records[i].stack == (uint64_t) (uintptr_t) &stack
+            && (i == 0 || records[i - 1].time <= records[i].time);
+    }
+    correct = correct && ops[TRACE_CTOR] == 1 && ops[TRACE_PUSH] == 100
+        && ops[TRACE_POP] == 50 && ops[TRACE_RESIZE] > 0
+        && ops[TRACE_DTOR] == 1;
+    free(records);
+
+    return correct;
+#else
+    return true;
+#endif
+}
+
+bool test_14()
+{
+    Elem_t buffer[fixedStackBufferLength(16)] = {};
+    FixedStack stack = {};
+    size_t error = STACK_NO_ERRORS;
+    fixedStackCtor(&stack, buffer, fixedStackBufferLength(16), &error)
+
+    for (int i = 0; i < 16; i++)
+        error |= fixedStackPush(&stack, i);
+    bool correct = !error && stack.capacity == 16
+        && fixedStackPush(&stack, 16) == STACK_OVERFLOW
+        && stack.size == 16;
+
+    Elem_t value = 0;
+    error |= fixedStackPop(&stack, &value);
+    correct = correct && value == 15;
+
+#if (CanaryProtection)
+    buffer[fixedStackBufferLength(16) - 1] = 0;
+    correct = correct
+        && (fixedStackVerifier(&stack) & STACK_END_DATA_CANARY_DEAD);
+    buffer[fixedStackBufferLength(16) - 1] = FIXED_CANARY_END;
+#endif
+#if (HashProtection)
+    stack.data[3] = -3;
+    correct = correct && (fixedStackVerifier(&stack) & STACK_INCORRECT_HASH);
+    stack.data[3] = 3;
+#endif
+
+    error |= fixedStackDtor(&stack);
+    correct = correct && (fixedStackPush(&stack, 1) & STACK_NOT_ALIVE);
+
+    StaticStack<4> staticStack = {};
+    error |= staticStackCtor(&staticStack);
+    error |= fixedStackPush(&staticStack.stack, 42);
+    error |= fixedStackPop(&staticStack.stack, &value);
+    correct = correct && value == 42
+        && fixedStackPop(&staticStack.stack, &value) == STACK_IS_EMPTY;
+    error |= fixedStackDtor(&staticStack.stack);
+
+    return correct && !error;
+}
+
+bool test_15()
+{
+    TieredStackConfig config = {};
+    config.segmentSize = 64;
+    config.hotSegments = 2;
+
+    TieredStack stack = {};
+    size_t error = STACK_NO_ERRORS;
+    tieredStackCtor(&stack, config, &error)
+
+    for (int i = 0; i < 1000; i++)
+        error |= tieredStackPush(&stack, i);
+
+    bool correct = !error && tieredStackSize(&stack) == 1000
+        && stack.hot.size <= 128 && stack.stats.spilled == 14;
+
+    for (int i = 999; i >= 0; i--)
+    {
+        Elem_t value = 0;
+        error |= tieredStackPop(&stack, &value);
+        correct = correct && value == i;
+    }
+    correct = correct && !error && tieredStackSize(&stack) == 0
+        && stack.stats.loaded == stack.stats.spilled
+        && stack.stats.prefetched > 0;
+
+    for (int i = 0; i < 200; i++)
+        error |= tieredStackPush(&stack, i);
+    Elem_t garbage = -1;
+    correct = correct && !error && stack.segmentsCount == 2
+        && pwrite(fileno(stack.file), &garbage, sizeof(garbage), 64 * 4 + 8)
+            == sizeof(garbage);
+
+    size_t popError = STACK_NO_ERRORS;
+    for (int i = 0; i < 200 && !popError; i++)
+    {
+        Elem_t value = 0;
+        popError = tieredStackPop(&stack, &value);
+    }
+#if (HashProtection)
+    correct = correct && popError == STACK_SEGMENT_CORRUPTED;
+#endif
+
+    error |= tieredStackDtor(&stack);
+    return correct && !error;
+}
+
+bool test_16()
+{
+    Elem_t values[] = {0, 1, 2, INT_MAX, INT_MIN, -1, 1, INT_MIN, INT_MAX};
+    const size_t count = sizeof(values) / sizeof(values[0]);
+    uint8_t data[count * TIERED_MAX_VARINT_SIZE] = {};
+    Elem_t decoded[count] = {};
+
+    size_t bytes = tieredCompress(values, count, data);
+    bool correct = bytes <= sizeof(data)
+        && tieredDecompress(data, bytes, decoded, count)
+        && memcmp(values, decoded, sizeof(values)) == 0
+        && !tieredDecompress(data, bytes - 1, decoded, count)
+        && !tieredDecompress(data, bytes, decoded, count - 1);
+
+    TieredStackConfig config = {};
+    config.segmentSize = 128;
+    config.hotSegments = 2;
+    config.storage = TIERED_STORAGE_COMPRESSED;
+
+    TieredStack stack = {};
+    size_t error = STACK_NO_ERRORS;
+    tieredStackCtor(&stack, config, &error)
+
+    for (int i = 0; i < 2000; i++)
+        error |= tieredStackPush(&stack, i);
+
+    correct = correct && !error && stack.file == nullptr
+        && stack.stats.spilled == 14
+        && stack.stats.rawBytes == 14 * 128 * sizeof(Elem_t)
+        && stack.stats.storedBytes * 2 <= stack.stats.rawBytes;
+
+    for (int i = 1999; i >= 1000; i--)
+    {
+        Elem_t value = 0;
+        error |= tieredStackPop(&stack, &value);
+        correct = correct && value == i;
+    }
+    correct = correct && !error && stack.stats.loaded > 0
+        && stack.stats.loadNanoseconds > 0;
+
+    stack.segments[0].data[0] ^= 0x7F;
+    size_t popError = STACK_NO_ERRORS;
+    for (int i = 0; i < 1000 && !popError; i++)
+    {
+        Elem_t value = 0;
+        popError = tieredStackPop(&stack, &value);
+    }
+#if (HashProtection)
+    correct = correct && popError == STACK_SEGMENT_CORRUPTED;
+#endif
+
+    error |= tieredStackDtor(&stack);
+    return correct && !error;
+}
+
+bool test_17()
+{
+    Stack stack = {};
+    size_t error = STACK_NO_ERRORS;
+    stackCtor(&stack, 0, &error)
+    for (int i = 0; i < 1000; i++)
+        error |= stackPush(&stack, i % 10);
+
+    StackView view = {};
+    error |= stackViewCreate(&stack, &view);
+
+    int64_t sum = 0;
+    size_t count = 0;
+    size_t index = 0;
+    error |= stackViewSum(&view, &sum);
+    error |= stackViewCount(&view, 7, &count);
+    error |= stackViewFind(&view, 9, &index);
+
+    bool correct = !error && view.size == 1000 && sum == 4500
+        && count == 100 && index == 9
+        && std::accumulate(view.begin(), view.end(), 0) == 4500
+        && *std::max_element(view.begin(), view.end()) == 9;
+
+    error |= stackViewFind(&view, 42, &index);
+    correct = correct && !error && index == view.size;
+
+    Elem_t value = 0;
+    error |= stackPush(&stack, 1);
+    error |= stackPop(&stack, &value);
+    correct = correct && !error
+        && stackViewVerify(&view) == STACK_VIEW_INVALID
+        && stackViewSum(&view, &sum) == STACK_VIEW_INVALID;
+
+    error |= stackViewCreate(&stack, &view);
+    correct = correct && !error && stackViewVerify(&view) == STACK_NO_ERRORS;
+
+    error |= stackDtor(&stack);
+    correct = correct && stackViewVerify(&view) == STACK_VIEW_INVALID;
+
+    return correct && !error;
+}
+
+bool test_18()
+{
+    RingStack stack = {};
+    size_t error = STACK_NO_ERRORS;
+    ringStackCtor(&stack, 4, &error)
+    Elem_t *data = stack.data;
+
+    for (int i = 1; i <= 10; i++)
+        error |= ringStackPush(&stack, i);
+
+    bool correct = !error && stack.size == 4 && stack.discarded == 6
+        && stack.data == data;
+
+    Elem_t value = 0;
+    for (int i = 10; i >= 7; i--)
+    {
+        error |= ringStackPop(&stack, &value);
+        correct = correct && value == i;
+    }
+    correct = correct && !error
+        && ringStackPop(&stack, &value) == STACK_IS_EMPTY;
+
+    error |= ringStackPush(&stack, 11);
+    error |= ringStackPush(&stack, 12);
+    error |= ringStackPop(&stack, &value);
+    correct = correct && !error && value == 12 && stack.size == 1;
+
+#if (PoisonProtection)
+    size_t newest = (stack.top + stack.capacity - 1) % stack.capacity;
+    stack.data[newest] = POISON_VALUE;
+    correct = correct
+        && (ringStackVerifier(&stack) & STACK_POISONED_DATA);
+    stack.data[newest] = 11;
+#endif
+
+    error |= ringStackDtor(&stack);
+
+    return correct && !error;
+}
+
+static Stack *TEST_BUDGET_SLACK = nullptr;
+
+static void testBudgetTrimmer(const void *resizing,
+                              StackBudgetGroup group,
+                              size_t bytes)
+{
+    (void) group;
+    (void) bytes;
+    if (resizing != TEST_BUDGET_SLACK)
+        stackShrinkToFit(TEST_BUDGET_SLACK);
+}
+
+bool test_19()
+{
+    const StackBudgetGroup group = 1;
+    size_t base = stackBudgetGetUsage(STACK_BUDGET_ALL_GROUPS).bytes;
+
+    Stack stack = {};
+    Stack slack = {};
+    size_t error = STACK_NO_ERRORS;
+    stackCtor(&stack, 0, &error)
+    stackCtor(&slack, 256, &error)
+    error |= stackPush(&slack, 1);
+    error |= stackBudgetSetGroup(&slack, group);
+
+    bool correct = !error
+        && stackBudgetGetUsage(group).bytes == 256 * sizeof(Elem_t)
+        && stackBudgetGetUsage(STACK_BUDGET_ALL_GROUPS).bytes
+            == base + 256 * sizeof(Elem_t);
+
+    stackBudgetSetLimit(base + 512 * sizeof(Elem_t) + 8);
+    for (int i = 0; i < 256; i++)
+        error |= stackPush(&stack, i);
+    correct = correct && !error
+        && stackPush(&stack, 256) == STACK_OVER_BUDGET
+        && stack.size == 256
+        && stackBudgetGetUsage(STACK_BUDGET_ALL_GROUPS).failures != 0;
+
+    TEST_BUDGET_SLACK = &slack;
+    stackBudgetSetTrimmer(testBudgetTrimmer);
+    error |= stackPush(&stack, 256);
+    correct = correct && !error && slack.capacity == 1
+        && stackBudgetGetUsage(group).bytes == sizeof(Elem_t)
+        && stackBudgetGetUsage(group).highWater >= 256 * sizeof(Elem_t);
+
+    stackBudgetSetGroupLimit(group, sizeof(Elem_t));
+    error |= stackPush(&slack, 2);
+    correct = correct && !error
+        && stackBudgetGetUsage(group).softExceeded != 0;
+
+    stackBudgetSetTrimmer(nullptr);
+    stackBudgetSetGroupLimit(group, STACK_BUDGET_UNLIMITED);
+    stackBudgetSetLimit(STACK_BUDGET_UNLIMITED);
+    error |= stackDtor(&stack);
+    error |= stackDtor(&slack);
+
+    return correct && !error
+        && stackBudgetGetUsage(STACK_BUDGET_ALL_GROUPS).bytes == base
+        && stackBudgetGetUsage(group).bytes == 0;
+}
+
+bool test_20()
+{
+    bool correct = true;
+#if (PoisonProtection)
+    const size_t count = 37;
+    const size_t positions[] = {0, 3, 4, 15, 16, 31, 36};
+    Elem_t data[count] = {};
+
+    StackSimdLevel level = stackSimdGetLevel();
+    for (int wanted = STACK_SIMD_SCALAR; wanted <= level; wanted++)
+    {
+        correct = correct
+            && stackSimdSetLevel((StackSimdLevel) wanted) == wanted;
+
+        std::fill(data, data + count, 1);
+        correct = correct && stackFindPoison(data, count) == count;
+        for (size_t position: positions)
+        {
+            data[position] = POISON_VALUE;
+            correct = correct
+                && stackFindPoison(data, count) == position
+                && stackFindPoison(data, position) == position;
+            data[position] = 1;
+        }
+
+        stackFillPoison(data + 1, count - 2);
+        correct = correct && data[0] == 1 && data[count - 1] == 1
+            && std::count(data, data + count, POISON_VALUE)
+                == (long) count - 2;
+    }
+    stackSimdSetLevel(level);
+
+    Stack stack = {};
+    size_t error = STACK_NO_ERRORS;
+    stackCtor(&stack, 0, &error)
+    for (int i = 0; i < 100; i++)
+        error |= stackPush(&stack, i);
+
+    stack.data[42] = POISON_VALUE;
+    correct = correct && !error
+        && stackFindPoison(stack.data, stack.size) == 42
+        && (stackVerifier(&stack) & STACK_POISONED_DATA);
+    stack.data[42] = 42;
+    error |= stackDtor(&stack);
+    correct = correct && !error;
+#endif
+    return correct;
+}
+
+bool test_21()
+{
+    const size_t count = 100;
+    StackBatch batch = {};
+    size_t error = STACK_NO_ERRORS;
+    stackBatchCtor(&batch, count, 3, &error)
+
+    Elem_t values[count] = {};
+    uint8_t mask[count] = {};
+    uint8_t failed[count] = {};
+    for (size_t i = 0; i < count; i++)
+    {
+        values[i] = (Elem_t) i;
+        mask[i] = i % 2 == 0;
+    }
+
+    for (int round = 0; round < 3; round++)
+        error |= stackBatchPush(&batch, values, nullptr, nullptr);
+    bool correct = !error
+        && stackBatchPush(&batch, values, mask, failed) == STACK_OVERFLOW
+        && failed[0] == 1 && failed[1] == 0;
+
+    StackBatchView view = {};
+    error |= stackBatchViewCreate(&batch, 7, &view);
+    correct = correct && !error && view.size == 3
+        && std::accumulate(view.begin(), view.end(), 0) == 21;
+
+    error |= stackBatchPop(&batch, values, mask, nullptr);
+    correct = correct && !error && values[4] == 4 && values[5] == 5
+        && batch.sizes[4] == 2 && batch.sizes[5] == 3
+        && stackBatchViewVerify(&view) == STACK_VIEW_INVALID;
+
+    for (int round = 0; round < 2; round++)
+        error |= stackBatchPop(&batch, values, mask, nullptr);
+    correct = correct && !error
+        && stackBatchPop(&batch, values, mask, failed) == STACK_IS_EMPTY
+        && failed[2] == 1 && failed[3] == 0 && values[2] == 0;
+
+#if (PoisonProtection)
+    batch.data[5 * 3 + 1] = POISON_VALUE;
+    correct = correct
+        && (stackBatchVerifier(&batch) & STACK_POISONED_DATA);
+    batch.data[5 * 3 + 1] = 5;
+#endif
+
+    error |= stackBatchDtor(&batch);
+
+    return correct && !error;
+}
+
+bool test_22()
+{
+    StackDumpLimits limits = {};
+    limits.forkChildren = 1;
+    stackDumpConfigure(limits);
+
+    FILE *logFile = tmpfile();
+    if (logFile == nullptr)
+        return false;
+    STACK_LOG_FILE = logFile;
+
+    Stack stack = {};
+    size_t error = STACK_NO_ERRORS;
+    stackCtor(&stack, 0, &error)
+    for (int i = 0; i < 10; i++)
+        error |= stackPush(&stack, i);
+
+    const size_t errors[] = {STACK_INCORRECT_HASH,
+                             STACK_DATA_INCORRECT_HASH,
+                             STACK_POISONED_DATA};
+    StackInfo info = {__LINE__, __FILE__, __PRETTY_FUNCTION__, "stack"};
+    for (size_t dumpError : errors)
+        stackDump(&stack, &info, dumpError);
+    stackDumpWaitChildren();
+
+    StackDumpStats stats = stackDumpGetStats();
+    bool correct = !error && stats.full == 3 && stats.forked >= 1
+        && stats.forked + stats.compact == 3;
+
+    char buffer[4096] = {};
+    rewind(logFile);
+    size_t read = fread(buffer, 1, sizeof(buffer) - 1, logFile);
+    correct = correct && read > 0
+        && strstr(buffer, "-----START LOGGING STACK-----") != nullptr
+        && strstr(buffer, "-----END LOGGING STACK-----") != nullptr;
+
+    STACK_LOG_FILE = stderr;
+    fclose(logFile);
+    stackDumpConfigure({});
+
+    error |= stackDtor(&stack);
+    return correct && !error;
+}
+
+bool test_23()
+{
+    AggregateStack stack = {};
+    size_t error = STACK_NO_ERRORS;
+    aggregateStackCtor(&stack, 64, &error)
+
+    stackBudgetSetLimit(stackBudgetGetUsage(STACK_BUDGET_ALL_GROUPS).bytes
+                        + 8 * sizeof(Elem_t));
+    // data stack has room, min stack runs out of budget at fifth push
+    Elem_t pushed = 0;
+    size_t pushError = STACK_NO_ERRORS;
+    while (!pushError and pushed < 64)
+    {
+        pushError = aggregateStackPush(&stack, 100 - pushed);
+        if (!pushError)
+            pushed++;
+    }
+
+    const Elem_t values[] = {10, 9, 8, 7};
+    size_t pushManyError = aggregateStackPushMany(&stack, values, 4);
+
+    Elem_t min = 0;
+    Elem_t max = 0;
+    int64_t sum = 0;
+    error |= stackMin(&stack, &min);
+    error |= stackMax(&stack, &max);
+    error |= stackSum(&stack, &sum);
+    bool correct = !error && pushError == STACK_OVER_BUDGET
+        && pushManyError == STACK_OVER_BUDGET
+        && pushed == 4 && stack.stack.size == 4
+        && min == 97 && max == 100 && sum == 100 + 99 + 98 + 97
+        && aggregateStackVerifier(&stack) == STACK_NO_ERRORS;
+
+    stackBudgetSetLimit(STACK_BUDGET_UNLIMITED);
+    for (Elem_t i = pushed - 1; i >= 0; i--)
+    {
+        Elem_t value = 0;
+        error |= aggregateStackPop(&stack, &value);
+        correct = correct && value == 100 - i;
+        if (i > 0)
+        {
+            error |= stackMin(&stack, &min);
+            correct = correct && min == 100 - i + 1;
+        }
+    }
+    correct = correct && stack.minStack.size == 0
+        && stack.maxStack.size == 0;
+
+    error |= aggregateStackDtor(&stack);
+    return correct && !error;
+}
+
+bool test_24()
+{
+    StackDumpLimits limits = {};
+    limits.fullPerSecond = STACK_MAX_CALLSITES + 2;
+    limits.linesPerSecond = SIZE_MAX;
+    stackDumpConfigure(limits);
+
+    FILE *logFile = tmpfile();
+    if (logFile == nullptr)
+        return false;
+    STACK_LOG_FILE = logFile;
+
+    static char stacks[STACK_MAX_CALLSITES + 1] = {};
+    StackInfo info = {__LINE__, __FILE__, __PRETTY_FUNCTION__, "stacks"};
+    bool correct = true;
+    for (size_t i = 0; i < STACK_MAX_CALLSITES; i++)
+        correct = correct
+            && stackDumpThrottle(&stacks[i], &info, STACK_NOT_ALIVE);
+
+    // untracked error still gets full dumps until per-second limit
+    const void *untracked = &stacks[STACK_MAX_CALLSITES];
+    correct = correct
+        && stackDumpThrottle(untracked, &info, STACK_NOT_ALIVE)
+        && stackDumpThrottle(untracked, &info, STACK_NOT_ALIVE)
+        && !stackDumpThrottle(untracked, &info, STACK_NOT_ALIVE);
+
+    StackDumpStats stats = stackDumpGetStats();
+    correct = correct && stats.full == STACK_MAX_CALLSITES + 2
+        && stats.lines == 1 && stats.untracked == 3
+        && stats.suppressed == 0 && ftell(logFile) > 0;
+
+    STACK_LOG_FILE = stderr;
+    fclose(logFile);
+    stackDumpConfigure({});
+    return correct;
+}
+
+bool test_25()
+{
+    Stack stack = {};
+    size_t error = STACK_NO_ERRORS;
+    stackCtor(&stack, 0, &error)
+
+    for (Elem_t i = 0; i < 100; i++)
+        error |= stackPush(&stack, i);
+    bool correct = !error && stack.size == 100 && stack.capacity == 128;
+
+    // pops above quarter of capacity may go inline, others shrink buffer
+    for (Elem_t i = 99; i >= 0; i--)
+    {
+        Elem_t value = 0;
+        error |= stackPop(&stack, &value);
+        correct = correct && value == i;
+    }
+    correct = correct && !error && stack.size == 0 && stack.capacity == 1
+        && stack.data != nullptr;
+
+    Elem_t value = -1;
+    correct = correct && stackPop(&stack, &value) == STACK_IS_EMPTY
+        && value == 0;
+
+    error |= stackPush(&stack, 7);
+    error |= stackPop(&stack, &value);
+    correct = correct && !error && value == 7 && stack.capacity == 1
+        && stack.data != nullptr;
+
+    error |= stackDtor(&stack);
+    return correct && !error;
+}
+
+bool test_26()
+{
+#if (HashProtection)
+    StackHashConfig defaultConfig = stackHashGetConfig();
+    StackHashConfig config = {};
+    config.threads = 4;
+    config.threshold = 1024;
+    config.chunkSize = 256;
+    stackHashConfigure(config);
+
+    StackDumpLimits limits = {};
+    limits.forkChildren = 1;
+    stackDumpConfigure(limits);
+
+    FILE *logFile = tmpfile();
+    if (logFile == nullptr)
+        return false;
+    STACK_LOG_FILE = logFile;
+
+    Stack stack = {};
+    size_t error = STACK_NO_ERRORS;
+    stackCtor(&stack, 0, &error)
+    Elem_t values[1000] = {};
+    for (int i = 0; i < 1000; i++)
+        values[i] = i;
+    error |= stackPushMany(&stack, values, 1000);
+
+    // child hashes chunks without worker threads, which fork didn't copy
+    stack.data[700] = -1;
+    size_t verifierError = stackVerifier(&stack);
+    StackInfo info = {__LINE__, __FILE__, __PRETTY_FUNCTION__, "stack"};
+    stackDump(&stack, &info, verifierError);
+    stackDumpWaitChildren();
+    stack.data[700] = 700;
+
+    StackDumpStats stats = stackDumpGetStats();
+    bool correct = !error && stats.forked == 1
+        && (verifierError & STACK_DATA_INCORRECT_HASH);
+
+    static char buffer[1 << 16] = {};
+    rewind(logFile);
+    size_t read = fread(buffer, 1, sizeof(buffer) - 1, logFile);
+    buffer[read] = '\0';
+    correct = correct
+        && strstr(buffer, "Corrupted data chunk") != nullptr
+        && strstr(buffer, "-----END LOGGING STACK-----") != nullptr;
+
+    STACK_LOG_FILE = stderr;
+    fclose(logFile);
+    stackDumpConfigure({});
+
+    error |= stackDtor(&stack);
+    stackHashConfigure(defaultConfig);
+    return correct && !error;
+#else
+    return true;
+#endif
+}
+
+bool test_27()
+{
+#if (WatchdogProtection)
+    TieredStackConfig config = {};
+    config.segmentSize = 64;
+    config.hotSegments = 2;
+    config.storage = TIERED_STORAGE_COMPRESSED;
+
+    TieredStack stack = {};
+    size_t error = STACK_NO_ERRORS;
+    tieredStackCtor(&stack, config, &error)
+
+    std::atomic<bool> running(true);
+    std::atomic<size_t> broken(0);
+    std::thread checker([&running, &broken]()
+                        {
+                            while (running.load())
+                                broken += stackWatchdogCheckAll();
+                        });
+
+    // spills move hot data while watchdog reads it
+    stackWatchdogStart(1);
+    for (int round = 0; round < 2; round++)
+    {
+        for (int i = 0; i < 20000; i++)
+            error |= tieredStackPush(&stack, i);
+        for (int i = 0; i < 20000; i++)
+        {
+            Elem_t value = 0;
+            error |= tieredStackPop(&stack, &value);
+        }
+    }
+    stackWatchdogStop();
+
+    running = false;
+    checker.join();
+
+    bool correct = !error && broken == 0 && stack.stats.spilled >= 500;
+    error |= tieredStackDtor(&stack);
+    return correct && !error;
+#else
+    return true;
+#endif
+}
+
+bool test_28()
+{
+    const size_t count = 37;
+    const size_t capacity = 3;
+    Elem_t data[count * capacity] = {};
+    StackSize_t sizes[count] = {};
+    Elem_t values[count] = {};
+    Elem_t popped[count] = {};
+    uint8_t mask[count] = {};
+    uint8_t failed[count] = {};
+
+    bool correct = true;
+    StackSimdLevel level = stackSimdGetLevel();
+    for (int wanted = STACK_SIMD_SCALAR; wanted <= level; wanted++)
+    {
+        correct = correct
+            && stackSimdSetLevel((StackSimdLevel) wanted) == wanted;
+
+        size_t full = 0;
+        for (size_t i = 0; i < count * capacity; i++)
+            data[i] = -(Elem_t) i - 1;
+        for (size_t i = 0; i < count; i++)
+        {
+            sizes[i] = (StackSize_t) (i % (capacity + 1));
+            values[i] = (Elem_t) i;
+            mask[i] = i % 3 != 0;
+            failed[i] = 0;
+            full += mask[i] and sizes[i] == capacity;
+        }
+
+        correct = correct
+            && stackScatterPush(data, sizes, count, capacity,
+                                values, mask, failed) == full;
+
+        size_t empty = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            size_t initial = i % (capacity + 1);
+            bool pushed = mask[i] and initial != capacity;
+            correct = correct
+                && sizes[i] == initial + pushed
+                && failed[i] == (mask[i] and initial == capacity)
+                && (!pushed or data[i * capacity + initial] == values[i]);
+            empty += sizes[i] == 0;
+            failed[i] = 0;
+            popped[i] = -1;
+        }
+
+        correct = correct
+            && stackGatherPop(data, sizes, count, capacity,
+                              popped, nullptr, failed) == empty;
+
+        for (size_t i = 0; i < count; i++)
+        {
+            size_t initial = i % (capacity + 1);
+            bool pushed = mask[i] and initial != capacity;
+            size_t size = initial + pushed;
+            Elem_t top = pushed ? values[i]
+                                : -(Elem_t) (i * capacity + size - 1) - 1;
+            correct = correct && failed[i] == (size == 0)
+                && popped[i] == (size == 0 ? 0 : top)
+                && sizes[i] == (size == 0 ? 0 : size - 1);
+#if (PoisonProtection)
+            correct = correct
+                && (size == 0
+                    or data[i * capacity + size - 1] == POISON_VALUE);
+#endif
+        }
+    }
+    stackSimdSetLevel(level);
+
+    return correct;
+}
+
+bool test_29()
+{
+    StackDumpLimits limits = {};
+    limits.forkChildren = 1;
+    stackDumpConfigure(limits);
+
+    FILE *logFile = tmpfile();
+    if (logFile == nullptr)
+        return false;
+    STACK_LOG_FILE = logFile;
+
+    Stack stack = {};
+    size_t error = STACK_NO_ERRORS;
+    stackCtor(&stack, 0, &error)
+    for (int i = 0; i < 1000; i++)
+        error |= stackPush(&stack, i);
+
+    // parent keeps logging while child writes full dump
+    StackInfo info = {__LINE__, __FILE__, __PRETTY_FUNCTION__, "stack"};
+    stackDump(&stack, &info, STACK_INCORRECT_HASH);
+    for (int i = 0; i < 2000; i++)
+    {
+        logStack(logFile, "parent line\n");
+        usleep(50);
+    }
+    stackDumpWaitChildren();
+
+    fseek(logFile, 0, SEEK_END);
+    size_t size = (size_t) ftell(logFile);
+    char *log = (char *) calloc(size + 1, 1);
+    rewind(logFile);
+    bool correct = !error && log != nullptr
+        && fread(log, 1, size, logFile) == size;
+
+    char *start = correct ? strstr(log, "-----START LOGGING STACK-----")
+                          : nullptr;
+    char *end = start != nullptr
+                ? strstr(start, "-----END LOGGING STACK-----")
+                : nullptr;
+    correct = correct && end != nullptr;
+    if (correct)
+    {
+        *end = '\0';
+        correct = strstr(start, "parent line") == nullptr;
+    }
+    free(log);
+
+    STACK_LOG_FILE = stderr;
+    fclose(logFile);
+    stackDumpConfigure({});
+
+    error |= stackDtor(&stack);
+    return correct && !error;
+}
+
 int main()
 {
     assert(test_1());
     assert(test_2());
     assert(test_3());
     assert(test_4());
+    assert(test_5());
+    assert(test_6());
+    assert(test_7());
+    assert(test_8());
+    assert(test_9());
+    assert(test_10());
+    assert(test_11());
+    assert(test_12());
+    assert(test_13());
+    assert(test_14());
+    assert(test_15());
+    assert(test_16());
+    assert(test_17());
+    assert(test_18());
+    assert(test_19());
+    assert(test_20());
+    assert(test_21());
+    assert(test_22());
+    assert(test_23());
+    assert(test_24());
+    assert(test_25());
+    assert(test_26());
+    assert(test_27());
+    assert(test_28());
+    assert(test_29());
 }